@@ -0,0 +1,21 @@
+// Rigid parts turning at a constant speed, see spin.h
+// Needs frame.glsl for the time
+uniform vec4 spinaxis;		// World space unit axis, w is the speed in radians per second
+uniform vec4 spinpivot;		// World space point on the axis, w is the angle at time 0
+
+// Rotation of the draw at this frame's time, right handed about the axis. A zero spin gives
+// exactly the identity
+mat3 spinRotation()
+{
+	float angle = spinpivot.w + spinaxis.w * time;
+	float c = cos(angle), s = sin(angle);
+	vec3 k = spinaxis.xyz;
+	mat3 cross = mat3(0.0, k.z, -k.y, -k.z, 0.0, k.x, k.y, -k.x, 0.0);
+	return mat3(c) + s * cross + (1.0 - c) * outerProduct(k, k);
+}
+
+// Turn a world space point about the pivot
+vec4 spinWorld(vec4 world, mat3 spin)
+{
+	return vec4(spinpivot.xyz + spin * (world.xyz - spinpivot.xyz), world.w);
+}
@@ -23,6 +23,9 @@ if you prefer */
 #include "wrapper_glfw.h"
 #include <iostream>
 #include <stack>
+#include <deque>
+#include <cassert>
+#include <cstdlib>
 
 /* Include GLM core and matrix extensions*/
 #include <glm/glm.hpp>
@@ -34,18 +37,82 @@ if you prefer */
 #include "cube.h"
 #include "cylinder.h"
 #include "square.h"
+#include "shadervariants.h"
+#include "shaderloader.h"
+#include "shaderwatcher.h"
+#include "frameblock.h"
+#include "lightclusters.h"
+#include "deferredrenderer.h"
+#include "shadowcubemap.h"
+#include "samplecounter.h"
+#include "spin.h"
+#include "commandbuffer.h"
+#include "parallel.h"
+#include "framearena.h"
+#include "allocationcounter.h"
+#include "spherebenchmark.h"
+#include <algorithm>
+#include <map>
 
 /* Define buffer object indices */
 GLuint elementbuffer;
 
 GLuint program;		/* Identifier for the shader prgoram */
+GLuint fallbackprogram;	/* Plain shaded program drawn with while the real one compiles */
+
+/* The main shaders are built as one program per colour mode and emit mode, see shadervariants.h */
+const GLuint NUM_COLOURMODES = 4;
+ShaderVariants shaders("vertex-shader.vert", "fragment-shader.frag");
+size_t shadervariant[NUM_COLOURMODES][2];	/* Variant for each colour mode with emit mode off and on */
+
+/* The deferred path draws the scene into a G-buffer with the same vertex shader, then lights
+   it in separate passes, see deferredrenderer.h */
+DeferredRenderer deferredrenderer;
+ShaderVariants gbuffershaders("vertex-shader.vert", "gbuffer.frag");
+ShaderVariants lightshaders("deferred-light.vert", "deferred-light.frag");
+ShaderVariants volumeshaders("deferred-volume.vert", "deferred-volume.frag");
+size_t gbuffervariant[2];					/* Emit mode off and on, the colour mode only matters when lighting */
+size_t lightvariant[NUM_COLOURMODES];
+size_t volumevariant[NUM_COLOURMODES];
+bool usedeferred;		/* Chosen with the G key */
+bool deferredframe;		/* Drawing this frame deferred, once its programs are ready */
+
+/* Shadows of the main light, from a cube shadow map whose faces are only redrawn when
+   something in them moves, see shadowcubemap.h */
+ShadowCubeMap shadowmap;
+ShaderVariants shadowshaders("shadow.vert", "shadow.frag");
+size_t shadowvariant;
+const GLfloat SHADOW_FAR = 5.f;			/* Far plane of the shadow map, past the whole turntable */
+const GLfloat SHADOW_BIAS = 0.01f;		/* Depth bias against shadow acne, in world units */
+bool showshadows;
+
+/* Optional depth pre-pass: the scene's depth is laid down first with a position only program
+   so the shading pass (tested with GL_EQUAL) shades each sample once. Overdraw is counted
+   with occlusion queries for both passes */
+ShaderVariants depthshaders("depth.vert", "depth.frag");
+size_t depthvariant;
+bool usedepthprepass;	/* Chosen with the E key */
+bool showoverdraw;		/* Print overdraw once a second, chosen with the Q key */
+SampleCounter prepasssamples, shadedsamples;
+GLint windowsamples;	/* Samples per pixel of the window */
+
+/* Data that only lives for one frame, the matrix stack and the scene lists, comes from a
+   frame arena (see framearena.h), so once the frames have settled display() doesn't touch
+   the heap. Debug builds check this with the allocation
+   counter. Anything that changes what is drawn (a key, a resize, a new program) may
+   allocate while it settles again */
+FrameArena framearena(64 * 1024);
+typedef std::stack<glm::mat4, std::deque<glm::mat4, ArenaAllocator<glm::mat4> > > MatrixStack;
+const size_t SETTLE_FRAMES = FrameArena::FRAMES + 2;
+size_t steadyframes;		/* Frames since anything changed */
+
+ShaderVariants *allshaders[] = { &shaders, &gbuffershaders, &lightshaders, &volumeshaders, &shadowshaders, &depthshaders };
+const size_t NUM_SHADERSETS = sizeof(allshaders) / sizeof(allshaders[0]);
+ShaderWatcher shaderwatcher;
 GLuint vao;			/* Vertex array (Containor) object. This is the index of the VAO that will be the container for
 					   our buffer objects */
 
-GLuint colourmode;	/* Index of a uniform to switch the colour mode in the vertex shader
-					  I've included this to show you how to pass in an unsigned integer into
-					  your vertex shader. */
-GLuint emitmode;
+GLuint colourmode;	/* Colour mode, selects which shader variant is drawn with */
 
 /* Position and view globals */
 GLfloat angle_x, angle_inc_x, x, model_scale, z, y, vx, vy, vz;
@@ -62,10 +129,25 @@ GLfloat light_y;
 GLfloat light_z;
 
 /* Uniforms*/
-GLuint modelID, viewID, projectionID, lightposID, normalmatrixID, bulbpositionID;
-GLuint colourmodeID, emitmodeID;
+GLuint modelID, normalmatrixID, bulbpositionID, spinaxisID, spinpivotID;
+FrameBlock frameblock;		/* Camera, light and lighting constants shared by every program */
+
+/* Small coloured lights over the scene, drawn with clustered lighting when turned on */
+const GLuint NUM_POINTLIGHTS = 1024;
+LightClusters lightclusters;
+std::vector<PointLight> pointlights;
+bool showpointlights;
+
+/* Uniform locations of each program, looked up the first time it is bound */
+struct ProgramUniforms
+{
+	GLuint modelID, normalmatrixID, spinaxisID, spinpivotID;
+};
+std::map<GLuint, ProgramUniforms> programuniforms;
 
 GLfloat aspect_ratio;		/* Aspect ratio of the window defined in the reshape callback*/
+GLuint viewport_width, viewport_height;
+const GLfloat FIELD_OF_VIEW = 30.f;	/* Vertical, in degrees */
 
 GLfloat rotation_angle;	//lateral rotation stick
 GLfloat rotation_lift;	//vertical rotation stick	
@@ -74,6 +156,15 @@ GLfloat disk_rotation_angle; //disk rotation angle
 
 GLfloat dial_rotation_angle; //dial rotaion angle
 
+/* While the stick is on the track the disk and the stick turn at a constant speed. They are
+   turned in the vertex shader from the frame time (see spin.h), so the angles above are only
+   brought up to date when the turning starts or stops or a key moves the stick */
+const GLfloat DISK_SPEED = -6.f;		/* Degrees per second, 0.1 a frame at 60Hz */
+const GLfloat STICK_SPEED = -0.15f;
+bool playing;			/* Stick on the track and turning */
+GLfloat playstart;		/* Time the angles were last brought up to date */
+double starttime;		/* glfwGetTime() at start up, the frame time counts from here */
+
 
 GLuint numspherevertices;
 
@@ -91,6 +182,251 @@ Cylinder dial(glm::vec3(0.66f, 0.66f, 0.66f));
 using namespace std;
 using namespace glm;
 
+/* Small enough to build synchronously at start up. Same attributes and transform uniforms
+   as the main shaders, lit with a fixed directional light */
+const char *fallbackVertexShader =
+	"#version 420 core\n"
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in vec4 colour;\n"
+	"layout(location = 2) in vec3 normal;\n"
+	"out vec4 fcolour;\n"
+	"layout(std140, binding = 0) uniform Frame { mat4 view, projection; };\n"
+	"uniform mat4 model;\n"
+	"uniform mat3 normalmatrix;\n"
+	"void main()\n"
+	"{\n"
+	"	float light = max(dot(normalize(normalmatrix * normal), vec3(0.0, 0.0, 1.0)), 0.0);\n"
+	"	fcolour = vec4(colour.rgb * (0.3 + 0.7 * light), colour.a);\n"
+	"	gl_Position = projection * view * model * vec4(position, 1.0);\n"
+	"}\n";
+
+const char *fallbackFragmentShader =
+	"#version 420 core\n"
+	"in vec4 fcolour;\n"
+	"out vec4 outputColour;\n"
+	"void main()\n"
+	"{\n"
+	"	outputColour = fcolour;\n"
+	"}\n";
+
+/* One object of the scene, recorded before anything is drawn so it can be drawn into the
+   shadow map as well as the screen */
+struct SceneDraw
+{
+	mat4 model;
+	const MeshDraw *mesh;
+	GLuint emit;		/* Emit mode, on for the light sphere */
+	Spin spin;			/* Turning of the whole draw about a fixed axis, applied in the vertex shader */
+};
+typedef pair<GLfloat, size_t> DrawDistance;
+FrameVector<SceneDraw> scene((ArenaAllocator<SceneDraw>(framearena)));
+FrameVector<ShadowCaster> shadowcasters((ArenaAllocator<ShadowCaster>(framearena)));
+FrameVector<size_t> castingdraws((ArenaAllocator<size_t>(framearena)));	/* Scene draw of each shadow caster */
+FrameVector<DrawDistance> draworder((ArenaAllocator<DrawDistance>(framearena)));	/* Distance to the near side of each draw, nearest first */
+FrameVector<DrawDistance> lastorder((ArenaAllocator<DrawDistance>(framearena)));	/* draworder of the frame before */
+
+/* Swap list for an empty one in this frame's arena block with room for count items. The old
+   memory isn't freed, it goes with its block */
+template<class T> void newFrameList(FrameVector<T> &list, size_t count)
+{
+	FrameVector<T>((ArenaAllocator<T>(framearena))).swap(list);
+	list.reserve(count);
+}
+
+/* Every mesh fits in this radius around its origin in its own model space */
+const GLfloat MESH_RADIUS = 1.2f;
+
+/* Radius of the sphere around a draw's origin its mesh fits in, in world space */
+GLfloat boundingRadius(const mat4 &model)
+{
+	return MESH_RADIUS * std::max(length(vec3(model[0])), std::max(length(vec3(model[1])), length(vec3(model[2]))));
+}
+
+/* Meshes are drawn at the coarsest level of detail whose error covers at most this many pixels */
+const GLfloat LOD_PIXEL_ERROR = 0.5f;
+
+/* Level of detail of a draw, from how many pixels one unit of its model space covers */
+GLuint detailLevel(const SceneDraw &draw, const mat4 &view)
+{
+	GLfloat depth = -(view * draw.model[3]).z;
+	if (depth <= 0.f)
+		return 0;
+	GLfloat scale = boundingRadius(draw.model) / MESH_RADIUS;
+	GLfloat pixelsperunit = scale * viewport_height / (2.f * tan(radians(FIELD_OF_VIEW) / 2.f) * depth);
+	return draw.mesh->level(LOD_PIXEL_ERROR / pixelsperunit);
+}
+
+void addDraw(const mat4 &model, const MeshDraw &mesh, GLuint emit = 0, const Spin &spin = Spin())
+{
+	SceneDraw d;
+	d.model = model;
+	d.mesh = &mesh;
+	d.emit = emit;
+	d.spin = spin;
+	scene.push_back(d);
+}
+
+/* Seconds since start up. Kept small so it stays precise as a float in the shaders */
+GLfloat animationTime()
+{
+	return (GLfloat)(glfwGetTime() - starttime);
+}
+
+/* Fold the turning since playstart into the disk and stick angles */
+void updateAngles(GLfloat now)
+{
+	if (playing)
+	{
+		disk_rotation_angle += DISK_SPEED * (now - playstart);
+		rotation_angle += STICK_SPEED * (now - playstart);
+	}
+	playstart = now;
+}
+
+/* Start turning when the stick is put on the track and stop when it reaches the end or is
+   lifted. Only the stick angle is worked out each frame, not the matrices */
+void updatePlaying(GLfloat now)
+{
+	GLfloat stick = playing ? rotation_angle + STICK_SPEED * (now - playstart) : rotation_angle;
+	bool ontrack = stick <= -17.5f && stick >= -40.f && rotation_lift == 0;
+	if (ontrack != playing)
+	{
+		updateAngles(now);
+		playing = ontrack;
+	}
+}
+
+/* Make the program current and look up its per draw uniforms. The rest come from the frame
+   block. Uniforms a program doesn't have come back as -1 and setting them does nothing */
+void bindProgram(GLuint newprogram)
+{
+	if (newprogram == program)
+		return;
+	program = newprogram;
+	glUseProgram(program);
+
+	map<GLuint, ProgramUniforms>::iterator found = programuniforms.find(program);
+	if (found == programuniforms.end())
+	{
+		ProgramUniforms uniforms;
+		uniforms.modelID = glGetUniformLocation(program, "model");
+		uniforms.normalmatrixID = glGetUniformLocation(program, "normalmatrix");
+		uniforms.spinaxisID = glGetUniformLocation(program, "spinaxis");
+		uniforms.spinpivotID = glGetUniformLocation(program, "spinpivot");
+		found = programuniforms.insert(make_pair(program, uniforms)).first;
+	}
+
+	modelID = found->second.modelID;
+	normalmatrixID = found->second.normalmatrixID;
+	spinaxisID = found->second.spinaxisID;
+	spinpivotID = found->second.spinpivotID;
+}
+
+/* Program for the current colour mode and the given emit mode, writing the G-buffer instead
+   when drawing deferred */
+GLuint variantProgram(GLuint emit)
+{
+	if (deferredframe)
+		return gbuffershaders.program(gbuffervariant[emit], fallbackprogram);
+	return shaders.program(shadervariant[colourmode][emit], fallbackprogram);
+}
+
+/* The sorted draws are recorded as commands (see commandbuffer.h) in partitions of this many,
+   each on its own worker thread, then replayed in order on this thread. Smaller scenes are
+   recorded here, starting the threads would cost more than the recording.
+   --draws-per-partition N on the command line changes it, e.g. 1 to record even this scene
+   on the worker threads */
+size_t drawsperpartition = 256;
+vector<CommandBuffer> commandbuffers;
+size_t numpartitions;
+
+/* Record the draws in draworder. Only reads the scene and the programs, no GL calls */
+void recordScene(const mat4 &view)
+{
+	numpartitions = (draworder.size() + drawsperpartition - 1) / drawsperpartition;
+	if (commandbuffers.size() < numpartitions)
+		commandbuffers.resize(numpartitions);
+
+	auto record = [&view](size_t p)
+	{
+		CommandBuffer &commands = commandbuffers[p];
+		commands.reset();
+
+		/* Draw the light with the emissive variant and everything else with the normal one */
+		GLuint current = 0;
+		size_t end = std::min(draworder.size(), (p + 1) * drawsperpartition);
+		for (size_t i = p * drawsperpartition; i < end; i++)
+		{
+			const SceneDraw &draw = scene[draworder[i].second];
+			GLuint program = variantProgram(draw.emit);
+			if (program != current)
+			{
+				commands.program(program);
+				current = program;
+			}
+			commands.transform(draw.model, transpose(inverse(mat3(view * draw.model))), draw.spin);
+			commands.draw(*draw.mesh, drawmode, detailLevel(draw, view));
+		}
+	};
+
+	if (numpartitions > 1)
+		Parallel::forEach(numpartitions, record);
+	else if (numpartitions == 1)
+		record(0);
+}
+
+/* Program binding for command replay */
+void bindCommandProgram(GLuint newprogram, CommandUniforms &uniforms)
+{
+	bindProgram(newprogram);
+	uniforms.model = modelID;
+	uniforms.normalmatrix = normalmatrixID;
+	uniforms.spinaxis = spinaxisID;
+	uniforms.spinpivot = spinpivotID;
+}
+
+/* Watch the files of every shader set for edits */
+void watchShaders()
+{
+	vector<string> files;
+	for (size_t s = 0; s < NUM_SHADERSETS; s++)
+	{
+		vector<string> setfiles = allshaders[s]->files();
+		files.insert(files.end(), setfiles.begin(), setfiles.end());
+	}
+	shaderwatcher.watch(files);
+}
+
+/* Print the samples shaded and (with the pre-pass) depth written per pixel sample, averaged
+   over about a second. The counts come back from the GPU a frame or two late */
+void reportOverdraw(bool prepass, GLint samplesperpixel)
+{
+	static GLuint64 shaded = 0, tested = 0;
+	static GLuint frames = 0, prepassframes = 0;
+	static double last = glfwGetTime();
+
+	GLuint counts;
+	shaded += shadedsamples.collect(counts);
+	frames += counts;
+	tested += prepasssamples.collect(counts);
+	prepassframes += counts;
+
+	double now = glfwGetTime();
+	if (now - last < 1.0)
+		return;
+
+	if (showoverdraw && frames > 0)
+	{
+		double samples = (double)viewport_width * viewport_height * samplesperpixel;
+		cout << "Overdraw: " << shaded / (frames * samples) << " shaded samples per sample";
+		if (prepass && prepassframes > 0)
+			cout << ", " << tested / (prepassframes * samples) << " written by the depth pre-pass";
+		cout << endl;
+	}
+	shaded = tested = 0;
+	frames = prepassframes = 0;
+	last = now;
+}
 
 void init(GLWrapper* glw)
 {
@@ -120,10 +456,14 @@ void init(GLWrapper* glw)
 	angle_inc_x = angle_inc_y = angle_inc_z = 0;
 	model_scale = 1.f;
 	aspect_ratio = 1.3333f;
-	colourmode = 1; emitmode = 0;
+	viewport_width = 1024; viewport_height = 768;
+	colourmode = 1;
 	numlats = 40;
 	numlongs = 40;		
 	disk_rotation_angle = 0.0;
+	playing = false;
+	playstart = 0.f;
+	starttime = glfwGetTime();
 	dial_rotation_angle = 0.0;
 
 	// Generate index (name) for one vertex array object
@@ -132,10 +472,11 @@ void init(GLWrapper* glw)
 	// Create the vertex array object and make it current
 	glBindVertexArray(vao);
 
-	/* Load and build the vertex and fragment shaders */
+	/* Build the fallback shaders now and start every variant of the real ones compiling in the
+	   background. Each variant is drawn with the fallback until it is ready */
 	try
 	{
-		program = glw->LoadShader("vertex-shader.vert", "fragment-shader.frag");
+		fallbackprogram = glw->BuildShaderProgram(fallbackVertexShader, fallbackFragmentShader);
 	}
 	catch (exception& e)
 	{
@@ -143,44 +484,117 @@ void init(GLWrapper* glw)
 		cin.ignore();
 		exit(0);
 	}
+	program = 0;
+	frameblock.create();
+	lightclusters.create();
+	deferredrenderer.create();
+	shadowmap.create(1024, 0.01f, SHADOW_FAR);
+	showshadows = true;
+	prepasssamples.create();
+	shadedsamples.create();
+	glGetIntegerv(GL_SAMPLES, &windowsamples);
+	usedepthprepass = false;
+	showoverdraw = false;
+	usedeferred = false;
+	deferredframe = false;
+
+	/* Spread the point lights over the turntable at a few heights, each a different hue */
+	showpointlights = false;
+	for (GLuint l = 0; l < NUM_POINTLIGHTS; l++)
+	{
+		GLfloat u = (l % 32) / 31.f, v = ((l / 32) % 32) / 31.f;
+		GLfloat hue = fmod(l * 0.618034f, 1.f) * 6.f;
+		PointLight light;
+		light.position = vec3(u * 2.2f - 1.1f, v * 1.5f - 0.75f, 0.05f + 0.15f * (l % 4));
+		light.radius = 0.2f;
+		light.colour = 0.5f * clamp(vec3(abs(hue - 3.f) - 1.f, 2.f - abs(hue - 2.f), 2.f - abs(hue - 4.f)), 0.f, 1.f);
+		pointlights.push_back(light);
+	}
 
-	/* Define uniforms to send to vertex shader */
-	modelID = glGetUniformLocation(program, "model");
-	colourmodeID = glGetUniformLocation(program, "colourmode");
-	emitmodeID = glGetUniformLocation(program, "emitmode");
-	viewID = glGetUniformLocation(program, "view");
-	projectionID = glGetUniformLocation(program, "projection");
-	lightposID = glGetUniformLocation(program, "lightpos");
-	normalmatrixID = glGetUniformLocation(program, "normalmatrix");
+	AsyncProgram::enableParallelCompile();
+	for (GLuint mode = 0; mode < NUM_COLOURMODES; mode++)
+	{
+		for (GLuint emit = 0; emit < 2; emit++)
+		{
+			vector<string> defines;
+			defines.push_back("COLOURMODE " + to_string(mode));
+			defines.push_back("EMITMODE " + to_string(emit));
+			shadervariant[mode][emit] = shaders.variant(defines);
+		}
 
-	/* create objects */
+		vector<string> defines(1, "COLOURMODE " + to_string(mode));
+		lightvariant[mode] = lightshaders.variant(defines);
+		volumevariant[mode] = volumeshaders.variant(defines);
+	}
+	for (GLuint emit = 0; emit < 2; emit++)
+		gbuffervariant[emit] = gbuffershaders.variant(vector<string>(1, "EMITMODE " + to_string(emit)));
+	shadowvariant = shadowshaders.variant(vector<string>());
+	depthvariant = depthshaders.variant(vector<string>());
+	watchShaders();
+
+	/* create objects. The meshes are queued in the builder, generated in parallel and then
+	   uploaded together by build() */
+	MeshBuilder builder;
 	aSquare.makeSquare();
-	aSphere.makeSphere(numlats, numlongs, vec3(1.0, 1.0, 1.0));
-	bulbSphere.makeSphere(numlats, numlongs, vec3(1.0, 0.647, 0.0));
-	stickSphere.makeSphere(numlats, numlongs, vec3(1.0, 0.0, 0.0));
-	aCube.makeCube();
-	bigCylinder.makeCylinder(true);
-	smallCylinder.makeCylinder(false);
-	tube.makeCylinder(false);
-	dial.makeCylinder(true);
+	aSphere.makeSphere(numlats, numlongs, vec3(1.0, 1.0, 1.0), builder);
+	bulbSphere.makeSphere(numlats, numlongs, vec3(1.0, 0.647, 0.0), builder);
+	stickSphere.makeSphere(numlats, numlongs, vec3(1.0, 0.0, 0.0), builder);
+	aCube.makeCube(builder);
+	bigCylinder.makeCylinder(true, builder);
+	smallCylinder.makeCylinder(false, builder);
+	tube.makeCylinder(false, builder);
+	dial.makeCylinder(true, builder);
+	builder.build();
 }
 
 void display()
 {
+	size_t allocations = AllocationCounter::count();
+	framearena.beginFrame();
+
 	glClearColor(0.0f, 0.0f, 0.1f, 1.0f);
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glEnable(GL_DEPTH_TEST);
 
-	glUseProgram(program);
+	/* Rebuild the shaders when one of their files is saved. The edited files are dropped from
+	   the loader's cache so they are read again */
+	vector<string> edited = shaderwatcher.changed();
+	if (!edited.empty())
+	{
+		steadyframes = 0;
+		for (size_t f = 0; f < edited.size(); f++)
+			ShaderLoader::forget(edited[f]);
+		for (size_t s = 0; s < NUM_SHADERSETS; s++)
+			allshaders[s]->reload();
+		watchShaders();
+	}
 
-	stack<mat4> model;
-	model.push(mat4(1.0f));
+	/* Swap in variants that have finished building between frames. If a build fails the
+	   program in use (the fallback at start up) stays. Old programs have been deleted and
+	   their names can be reused, so forget their uniforms */
+	bool changed = false;
+	for (size_t s = 0; s < NUM_SHADERSETS; s++)
+		changed = allshaders[s]->poll() || changed;
+	if (changed)
+	{
+		steadyframes = 0;
+		programuniforms.clear();
+		shadowmap.invalidate();
+	}
+	program = 0;
 
-	mat3 normalmatrix;
+	/* Draw deferred once every program it needs has been built, forward until then */
+	GLuint lightprogram = lightshaders.program(lightvariant[colourmode], 0);
+	GLuint volumeprogram = volumeshaders.program(volumevariant[colourmode], 0);
+	deferredframe = usedeferred && lightprogram && volumeprogram &&
+		gbuffershaders.program(gbuffervariant[0], 0) && gbuffershaders.program(gbuffervariant[1], 0);
 
-	mat4 projection = perspective(radians(30.0f), aspect_ratio, 0.1f, 100.0f);
+	MatrixStack model((deque<mat4, ArenaAllocator<mat4> >(ArenaAllocator<mat4>(framearena))));
+	model.push(mat4(1.0f));
+
+	mat4 projection = perspective(radians(FIELD_OF_VIEW), aspect_ratio, 0.1f, 100.0f);	// Also used by the light clusters
 
 	// Camera matrix
 	mat4 view = lookAt(
@@ -194,31 +608,20 @@ void display()
 	view = rotate(view, -radians(vy), vec3(0, 1, 0));
 	view = rotate(view, -radians(vz), vec3(0, 0, 1));
 
-	// Define the light position and transform by the view matrix
-	vec4 lightpos = view * vec4(light_x, light_y, light_z, 1.0);
-
+	GLfloat now = animationTime();
+	updatePlaying(now);
 
-	glUniform1ui(colourmodeID, colourmode);
-	glUniformMatrix4fv(viewID, 1, GL_FALSE, &view[0][0]);
-	glUniformMatrix4fv(projectionID, 1, GL_FALSE, &projection[0][0]);
-	glUniform4fv(lightposID, 1, value_ptr(lightpos));
+	/* Record the scene first, so it can be drawn into the shadow map as well as the screen */
+	newFrameList(scene, scene.size());
 
 	/* Draw a small sphere in the lightsource position to visually represent the light source */
 	model.push(model.top());
 	{
 		model.top() = translate(model.top(), vec3(light_x, light_y, light_z));
 		model.top() = scale(model.top(), vec3(0.05f, 0.05f, 0.05f)); // make a small sphere
-																	 // Recalculate the normal matrix and send the model and normal matrices to the vertex shader																							// Recalculate the normal matrix and send to the vertex shader																								// Recalculate the normal matrix and send to the vertex shader																								// Recalculate the normal matrix and send to the vertex shader																						// Recalculate the normal matrix and send to the vertex shader
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
 
 		/* Draw our lightposition sphere  with emit mode on*/
-		emitmode = 1;
-		glUniform1ui(emitmodeID, emitmode);
-		aSphere.drawSphere(drawmode);
-		emitmode = 0;
-		glUniform1ui(emitmodeID, emitmode);
+		addDraw(model.top(), aSphere.meshdraw, 1);
 	}
 	model.pop();
 
@@ -235,15 +638,8 @@ void display()
 		model.top() = translate(model.top(), vec3(x, y, z));
 		model.top() = scale(model.top(), vec3(3, 3, 0.5));
 
-		// Send the model uniform and normal matrix to the currently bound shader,
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		// Recalculate the normal matrix and send to the vertex shader
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
 		/* Draw our cube*/
-		aCube.drawCube(drawmode);
+		addDraw(model.top(), aCube.meshdraw);
 
 	}
 	model.pop();
@@ -254,12 +650,7 @@ void display()
 		model.top() = translate(model.top(), vec3(x - 0.59f, y + 0.59f, z + 0.14));
 		model.top() = scale(model.top(), vec3(0.3, 0.3, 0.05));//scale equally in all axis
 
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
-		aSquare.drawSquare(drawmode);
+		addDraw(model.top(), aSquare.meshdraw);
 	}
 	model.pop();
 
@@ -271,11 +662,7 @@ void display()
 		model.top() = rotate(model.top(), radians(dial_rotation_angle), vec3(0, 1, 0));
 		model.top() = scale(model.top(), vec3(0.1f, 0.1f, 0.1f)); 
 
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
-		dial.drawCylinder(drawmode);
+		addDraw(model.top(), dial.meshDraw());
 	}
 	model.pop();
 
@@ -284,20 +671,17 @@ void display()
 	{		
 		model.top() = translate(model.top(), vec3(x - 0.08, y, z + 0.15));
 
-		//check if stick is on the right position, if it is rotate the disk
-		if (rotation_angle <= -17.5 && rotation_angle >= -40 && rotation_lift == 0) disk_rotation_angle -= 0.1;
+		//while the stick is on the track the disk turns about its centre
+		Spin diskspin;
+		if (playing)
+			diskspin = Spin(normalize(mat3(model.top()) * vec3(0, 0, 1)), vec3(model.top()[3]), radians(DISK_SPEED), playstart);
 
 		model.top() = rotate(model.top(), radians(disk_rotation_angle), vec3(0, 0, 1));
 		model.top() = rotate(model.top(), radians(90.0f), vec3(1, 0, 0));
 		model.top() = scale(model.top(), vec3(0.59f, 0.03f, 0.59f));
 
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
 		/* Draw the big black disk*/
-		bigCylinder.drawCylinder(drawmode);
+		addDraw(model.top(), bigCylinder.meshDraw(), 0, diskspin);
 	}
 	model.pop();
 
@@ -308,13 +692,8 @@ void display()
 		model.top() = rotate(model.top(), radians(90.0f), vec3(1, 0, 0));//scale equally in all axis
 		model.top() = scale(model.top(), vec3(0.2f, 0.022f, 0.2f));//scale equally in all axis
 
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
 		/* Draw our small red disj*/
-		smallCylinder.drawCylinder(drawmode);
+		addDraw(model.top(), smallCylinder.meshDraw());
 	}
 	model.pop();
 
@@ -325,13 +704,8 @@ void display()
 		model.top() = rotate(model.top(), radians(90.0f), vec3(1, 0, 0));
 		model.top() = scale(model.top(), vec3(0.02f, 0.06f, 0.02f));
 
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
 		/* Draw the tube*/
-		tube.drawCylinder(drawmode);
+		addDraw(model.top(), tube.meshDraw());
 	}
 	model.pop();
 
@@ -341,13 +715,9 @@ void display()
 		model.top() = translate(model.top(), vec3(x + 0.6, y + 0.58, z + 0.16));
 		model.top() = rotate(model.top(), radians(90.0f), vec3(1, 0, 0));
 		model.top() = scale(model.top(), vec3(0.04f, 0.3f, 0.04f));
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
 
 		/* Draw the small center cylinder*/
-		tube.drawCylinder(drawmode);
+		addDraw(model.top(), tube.meshDraw());
 	}
 	model.pop();
 
@@ -356,8 +726,10 @@ void display()
 	{
 		model.top() = translate(model.top(), vec3(x + 0.6f, y + 0.6f, z + 0.275f));
 
-		//Define stick rotation boundaries, if stick is on top of the disk then move it at the same pace as the track is rotation
-		if (rotation_angle <= -17.5 && rotation_angle >= -40 && rotation_lift == 0) rotation_angle -= 0.0025;
+		//if stick is on top of the disk then move it at the same pace as the track is rotation, about its base
+		Spin stickspin;
+		if (playing)
+			stickspin = Spin(normalize(mat3(model.top()) * vec3(0, 0, 1)), vec3(model.top()[3]), radians(STICK_SPEED), playstart);
 
 		//stick rotations, applied in inverse to match the mathematical restrictions
 		model.top() = rotate(model.top(), radians(rotation_angle), vec3(0, 0, 1));
@@ -366,13 +738,8 @@ void display()
 
 		model.top() = scale(model.top(), vec3(0.125f, 2.2f, 0.1f));
 
-		glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-
-		normalmatrix = transpose(inverse(mat3(view * model.top())));
-		glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
 		/* Draw the stick*/
-		aCube.drawCube(drawmode);
+		addDraw(model.top(), aCube.meshdraw, 0, stickspin);
 		model.push(model.top());
 		{
 			//Draw the sphere connected to the stick without popping the previous transformation so the ball is also rotated around the same axis as the stick
@@ -380,33 +747,150 @@ void display()
 			model.top() = translate(model.top(), vec3(0.6 - x, -0.51 - y, 0.22 - z));
 			model.top() = translate(model.top(), vec3(x - 0.6, y + 0.275, z - 0.7));
 
-
 			model.top() = scale(model.top(), vec3(1 / 25.f, 1 / 25.f, 1 / 25.f));
 			model.top() = scale(model.top(), vec3(1 / 0.125f, 1 / 2.2f, 1 / 0.1f));
 
-			glUniformMatrix4fv(modelID, 1, GL_FALSE, &(model.top()[0][0]));
-			normalmatrix = transpose(inverse(mat3(view * model.top())));
-			glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
-
-			stickSphere.drawSphere(drawmode);
+			addDraw(model.top(), stickSphere.meshdraw, 0, stickspin);
 		}
 		model.pop();
 	}
 	model.pop();
 
+	// Define the light position and transform by the view matrix
+	vec4 lightpos = view * vec4(light_x, light_y, light_z, 1.0);
+
+	/* Everything that is the same for every draw this frame goes in the frame block once */
+	FrameData frame;
+	frame.view = view;
+	frame.projection = projection;
+	frame.lightpos = lightpos;
+	frame.attenuation = vec4(0.5f, 0.5f, 0.5f, 0.f);
+	frame.globalambient = vec4(0.05f, 0.05f, 0.05f, 1.0f);
+	frame.shininess = 8.f;
+	frame.time = now;
+	GLuint shadowprogram = showshadows ? shadowshaders.program(shadowvariant, 0) : 0;
+	frame.shadowparams = vec4(1.f / SHADOW_FAR, SHADOW_BIAS / SHADOW_FAR, shadowprogram ? 1.f : 0.f, 0.f);
+
+	/* Bin the point lights into clusters of the view frustum for the fragment shader. The
+	   deferred path finds the pixels each light reaches with its light volume instead */
+	static const vector<PointLight> nolights;
+	const vector<PointLight> &lights = showpointlights ? pointlights : nolights;
+	if (deferredframe)
+		lightclusters.uploadLights(lights, view);
+	else
+		lightclusters.update(lights, view, radians(FIELD_OF_VIEW), 0.1f, 100.0f,
+			viewport_width, viewport_height, frame);
+	lightclusters.bind();
+	frameblock.update(frame);
+
+	/* Draw the faces of the shadow map whose light or casters have moved. The light sphere
+	   has the light inside it, so it casts no shadow */
+	if (shadowprogram)
+	{
+		newFrameList(shadowcasters, scene.size());
+		newFrameList(castingdraws, scene.size());
+		for (size_t d = 0; d < scene.size(); d++)
+		{
+			if (scene[d].emit)
+				continue;
+			const mat4 &m = scene[d].model;
+			ShadowCaster caster;
+			caster.model = m;
+			caster.spin = scene[d].spin;
+			caster.centre = vec3(caster.spin.matrix(now) * m[3]);
+			caster.radius = boundingRadius(m);
+			shadowcasters.push_back(caster);
+			castingdraws.push_back(d);
+		}
+		shadowmap.update(shadowprogram, vec3(light_x, light_y, light_z), now, shadowcasters.data(),
+			shadowcasters.size(), [](size_t c) { scene[castingdraws[c]].mesh->draw(0); });
+	}
+	shadowmap.bind();
+
+	/* Draw front to back so the depth test throws away as much as it can before shading. The
+	   order hardly changes from one frame to the next, so while the scene has the same draws
+	   they start in last frame's order (still in the arena) and an insertion sort only moves
+	   the few that have swapped places */
+	draworder.swap(lastorder);
+	newFrameList(draworder, scene.size());
+	bool samedraws = lastorder.size() == scene.size();
+	for (size_t i = 0; i < scene.size(); i++)
+	{
+		size_t d = samedraws ? lastorder[i].second : i;
+		GLfloat distance = -(view * scene[d].model[3]).z - boundingRadius(scene[d].model);
+		draworder.push_back(make_pair(distance, d));
+	}
+	if (samedraws)
+	{
+		for (size_t i = 1; i < draworder.size(); i++)
+			for (size_t j = i; j > 0 && draworder[j] < draworder[j - 1]; j--)
+				swap(draworder[j], draworder[j - 1]);
+	}
+	else
+		sort(draworder.begin(), draworder.end());
+
+	/* The pre-pass needs the real programs, the fallback doesn't give invariant positions */
+	GLuint depthprogram = depthshaders.program(depthvariant, 0);
+	bool prepass = usedepthprepass && depthprogram &&
+		variantProgram(0) != fallbackprogram && variantProgram(1) != fallbackprogram;
+
+	recordScene(view);
+
+	if (deferredframe)
+		deferredrenderer.beginGeometry(viewport_width, viewport_height);
+
+	if (prepass)
+	{
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		prepasssamples.begin();
+		for (size_t p = 0; p < numpartitions; p++)
+			commandbuffers[p].replay(bindCommandProgram, depthprogram);
+		prepasssamples.end();
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		/* Only the nearest surface is left to shade and the depth is already written */
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	shadedsamples.begin();
+	for (size_t p = 0; p < numpartitions; p++)
+		commandbuffers[p].replay(bindCommandProgram);
+	shadedsamples.end();
+
+	if (prepass)
+	{
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+
+	reportOverdraw(prepass, deferredframe ? 1 : windowsamples);
+
+	if (deferredframe)
+		deferredrenderer.light(lightprogram, volumeprogram, (GLuint)lights.size());
+
 	glDisableVertexAttribArray(0);
 	glUseProgram(0);
 
 	angle_x += angle_inc_x;
 	angle_y += angle_inc_y;
 	angle_z += angle_inc_z;
+
+	if (steadyframes < SETTLE_FRAMES)
+		steadyframes++;
+	else
+		assert(AllocationCounter::count() == allocations && "a steady frame allocated from the heap");
+	(void)allocations;		/* Only read by the assert */
 }
 
 /* Called whenever the window is resized. The new window size is given, in pixels. */
 static void reshape(GLFWwindow* window, int w, int h)
 {
 	glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+	viewport_width = w;
+	viewport_height = h;
 	aspect_ratio = ((float)w / 640.f * 4.f) / ((float)h / 480.f * 3.f);
+	steadyframes = 0;
 }
 
 /* change view angle, exit upon ESC */
@@ -416,6 +900,11 @@ static void keyCallback(GLFWwindow* window, int key, int s, int action, int mods
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 
+	steadyframes = 0;
+
+	/* The keys below move the stick from where it has turned to so far */
+	updateAngles(animationTime());
+
 	if (key == 'Z' && x > -0.3) x -= speed;
 	if (key == 'X' && x < 0.3) x += speed;
 	if (key == 'C' && y > -0.3) y -= speed;
@@ -466,9 +955,15 @@ static void keyCallback(GLFWwindow* window, int key, int s, int action, int mods
 		}
 	}
 
+	if (key == 'L' && action == GLFW_PRESS) showpointlights = !showpointlights;
+	if (key == 'G' && action == GLFW_PRESS) usedeferred = !usedeferred;
+	if (key == 'K' && action == GLFW_PRESS) showshadows = !showshadows;
+	if (key == 'E' && action == GLFW_PRESS) usedepthprepass = !usedepthprepass;
+	if (key == 'Q' && action == GLFW_PRESS) showoverdraw = !showoverdraw;
+
 	if (key == ' ' && action != GLFW_PRESS)
 	{
-		colourmode = colourmode++ % 4;
+		colourmode = (colourmode + 1) % NUM_COLOURMODES;
 	}
 
 }
@@ -498,11 +993,18 @@ void displayControls() {
 	cout << "\t- B, N -> Move object in Z axis;\n" << endl;
 
 	cout << "\t- SPACE -> Colour mode" << endl;
+	cout << "\t- L -> Turn the point lights on / off" << endl;
+	cout << "\t- G -> Switch between forward and deferred shading" << endl;
+	cout << "\t- K -> Turn the shadows on / off" << endl;
+	cout << "\t- E -> Turn the depth pre-pass on / off" << endl;
+	cout << "\t- Q -> Print overdraw statistics on / off" << endl;
 	cout << "\t- ESC -> Terminate program" << endl;
 }
 
 int main(int argc, char* argv[])
 {
+	AllocationCounter::track();		/* Count what this (the render) thread allocates */
+
 	GLWrapper* glw = new GLWrapper(1024, 768, "Position light example");;
 
 	if (!ogl_LoadFunctions())
@@ -511,6 +1013,17 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
+	/* Compare the sphere meshes instead of running the scene */
+	if (argc > 1 && string(argv[1]) == "--benchmark-spheres")
+	{
+		SphereBenchmark::run();
+		delete(glw);
+		return 0;
+	}
+
+	if (argc > 2 && string(argv[1]) == "--draws-per-partition")
+		drawsperpartition = std::max(atoi(argv[2]), 1);
+
 	glw->setRenderer(display);
 	glw->setKeyCallback(keyCallback);
 	glw->setKeyCallback(keyCallback);
@@ -0,0 +1,18 @@
+// Point lights binned into clusters of the view frustum on the CPU, see lightclusters.h
+// Needs frame.glsl for the cluster terms
+#include "lights.glsl"
+layout(binding = 2) uniform usamplerBuffer lightgrid;		// Offset and count of each cluster's lights
+layout(binding = 3) uniform usamplerBuffer lightindices;
+
+// Diffuse and specular light from the point lights in this fragment's cluster
+vec3 clusterLighting(vec3 position, vec3 N, vec3 V, vec3 diffusecolour, vec3 specularcolour)
+{
+	ivec3 cluster = ivec3(gl_FragCoord.xy * clusterscale.xy, max(log(-position.z) * clusterscale.z + clusterscale.w, 0.0));
+	cluster = min(cluster, clustercount.xyz - 1);
+	uvec2 range = texelFetch(lightgrid, (cluster.z * clustercount.y + cluster.y) * clustercount.x + cluster.x).xy;
+
+	vec3 total = vec3(0.0);
+	for (uint i = range.x; i < range.x + range.y; i++)
+		total += pointLight(int(texelFetch(lightindices, int(i)).x), position, N, V, diffusecolour, specularcolour);
+	return total;
+}
@@ -0,0 +1,14 @@
+// Specular colour of each colour mode. The mode is built into each program variant as a
+// constant, see shadervariants.h, so the compiler folds the lookup
+#ifndef COLOURMODE
+#define COLOURMODE 1
+#endif
+
+const vec4 specular_colour[] = vec4[](
+	vec4(0.0, 0.2, 0.9, 1.0),
+	vec4(1.0, 0.8, 0.6, 1.0),
+	vec4(0.0, 0.9, 0.6, 1.0),
+	vec4(0.8, 0.1, 0.3, 1.0),
+	vec4(0.5, 0.0, 0.6, 1.0),
+	vec4(0.0, 0.7, 0.0, 1.0)
+);
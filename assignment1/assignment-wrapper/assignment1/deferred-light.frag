@@ -0,0 +1,36 @@
+//Deferred lighting pass for the main light, ambient and emissive light, one fragment per pixel
+//The point lights are added on top by deferred-volume.frag
+//Andres Alvarez Olmo
+
+#version 420 core
+
+#include "colours.glsl"
+#include "frame.glsl"
+#include "lighting.glsl"
+#include "gbuffer.glsl"
+
+out vec4 outputColour;
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(gbuffer_depth, pixel, 0).r;
+
+	// Nothing was drawn here, so keep the clear colour
+	if (depth == 1.0)
+		discard;
+
+	vec4 albedo = texelFetch(gbuffer_albedo, pixel, 0);
+	vec4 diffusecolour = vec4(albedo.rgb, 1.0);
+	vec4 specularcolour = specular_colour[COLOURMODE];
+
+	vec3 position = gbufferPosition(pixel, depth);
+	vec3 N = decodeNormal(texelFetch(gbuffer_normal, pixel, 0).xy);
+	vec3 V = normalize(-position);
+
+	outputColour = mainLight(lightpos.xyz - position, N, V, diffusecolour, specularcolour)
+		+ global_ambient + ambientColour(diffusecolour, specularcolour);
+
+	//Emissive objects add their own light
+	if (albedo.a > 0.5)
+		outputColour += specularcolour;
+}
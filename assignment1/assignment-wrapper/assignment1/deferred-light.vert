@@ -0,0 +1,11 @@
+//Full screen triangle for the deferred lighting pass, no vertex attributes needed
+//Andres Alvarez Olmo
+
+#version 420 core
+
+void main()
+{
+	// Vertices 0, 1, 2 go to (-1, -1), (3, -1), (-1, 3), which covers the screen
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
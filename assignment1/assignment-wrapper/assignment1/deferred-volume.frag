@@ -0,0 +1,27 @@
+//Deferred lighting from one point light, run for the pixels its light volume covers
+//Adds to the result of deferred-light.frag with additive blending
+//Andres Alvarez Olmo
+
+#version 420 core
+
+#include "colours.glsl"
+#include "frame.glsl"
+#include "lights.glsl"
+#include "gbuffer.glsl"
+
+flat in int light;
+
+out vec4 outputColour;
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(gbuffer_depth, pixel, 0).r;
+	if (depth == 1.0)
+		discard;
+
+	vec3 position = gbufferPosition(pixel, depth);
+	vec3 N = decodeNormal(texelFetch(gbuffer_normal, pixel, 0).xy);
+	vec3 albedo = texelFetch(gbuffer_albedo, pixel, 0).rgb;
+
+	outputColour = vec4(pointLight(light, position, N, normalize(-position), albedo, specular_colour[COLOURMODE].rgb), 0.0);
+}
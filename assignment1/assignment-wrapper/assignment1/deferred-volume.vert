@@ -0,0 +1,22 @@
+//Light volume of one point light for the deferred path, instanced once per light
+//Andres Alvarez Olmo
+
+#version 420 core
+
+// Unit sphere mesh, see deferredrenderer.h
+layout(location = 0) in vec3 position;
+
+// How much to grow the mesh so its flat faces still cover the whole sphere
+uniform float volumescale;
+
+#include "frame.glsl"
+#include "lights.glsl"
+
+flat out int light;
+
+void main()
+{
+	light = gl_InstanceID;
+	vec4 positionradius = texelFetch(lightdata, light * 2);
+	gl_Position = projection * vec4(positionradius.xyz + position * positionradius.w * volumescale, 1.0);
+}
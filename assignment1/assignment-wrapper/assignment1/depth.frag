@@ -0,0 +1,8 @@
+//Depth pre-pass fragment shader, colour writes are off so only the depth is kept
+//Andres Alvarez Olmo
+
+#version 420 core
+
+void main()
+{
+}
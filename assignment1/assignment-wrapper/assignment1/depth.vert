@@ -0,0 +1,19 @@
+//Depth pre-pass vertex shader, only reads the positions
+//Andres Alvarez Olmo
+
+#version 420 core
+
+layout(location = 0) in vec3 position;
+
+#include "frame.glsl"
+#include "animation.glsl"
+uniform mat4 model;
+
+// The shading pass tests for equal depth, so both passes must work out exactly the same
+// position. Same expression as vertex-shader.vert and invariant in both
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = (projection * view) * spinWorld(model * vec4(position, 1.0), spinRotation());
+}
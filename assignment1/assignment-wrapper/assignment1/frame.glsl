@@ -0,0 +1,14 @@
+// Values shared by every draw in a frame, worked out once on the CPU
+// Must match FrameData in frameblock.h
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 view, projection;
+	vec4 lightpos;			// View space
+	vec4 attenuation;		// 1 / (x + y d + z d^2) for a distance d from the light
+	vec4 global_ambient;
+	float shininess;
+	float time;				// Seconds since start up, for animation.glsl
+	vec4 clusterscale;		// Light cluster of a fragment, see clusters.glsl
+	ivec4 clustercount;
+	vec4 shadowparams;		// Shadow map lookup, see shadow.glsl
+};
@@ -0,0 +1,25 @@
+//G-buffer fragment shader for the deferred path, see deferredrenderer.h
+//Only stores the surface, the lighting happens in deferred-light.frag and deferred-volume.frag
+//Andres Alvarez Olmo
+
+#version 420 core
+
+// The emit mode is built into each program variant as a constant, see shadervariants.h
+#ifndef EMITMODE
+#define EMITMODE 0
+#endif
+
+#include "frame.glsl"
+#include "gbuffer.glsl"
+
+//Inputs from vertex shader
+in vec3 fnormal, fposition;
+in vec4 fdiffusecolour;
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec2 normal;
+void main()
+{
+	albedo = vec4(fdiffusecolour.rgb, EMITMODE);
+	normal = encodeNormal(normalize(fnormal));
+}
@@ -0,0 +1,33 @@
+// G-buffer written by gbuffer.frag and read by the deferred lighting passes, see deferredrenderer.h
+// Needs frame.glsl to turn depth back into a view space position
+layout(binding = 4) uniform sampler2D gbuffer_albedo;		// Diffuse colour, emissive flag in alpha
+layout(binding = 5) uniform sampler2D gbuffer_normal;		// View space normal, octahedral encoded
+layout(binding = 6) uniform sampler2D gbuffer_depth;
+
+// Fold a unit vector onto the octahedron |x| + |y| + |z| = 1 and flatten it into a square,
+// unfolding the lower half over the corners. Stored in [0, 1] so it fits an unsigned format
+vec2 encodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.xy;
+	if (n.z < 0.0)
+		e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return e * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 e)
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+// View space position of a pixel, from its depth and the perspective projection
+vec3 gbufferPosition(ivec2 pixel, float depth)
+{
+	vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(gbuffer_depth, 0)) * 2.0 - 1.0;
+	float z = -projection[3][2] / (depth * 2.0 - 1.0 + projection[2][2]);
+	return vec3(ndc.x * -z / projection[0][0], ndc.y * -z / projection[1][1], z);
+}
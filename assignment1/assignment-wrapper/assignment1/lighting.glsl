@@ -0,0 +1,32 @@
+// The positional light, shared by the forward and deferred paths
+// Needs frame.glsl for the shininess and attenuation constants
+#include "shadow.glsl"
+
+// Diffuse and specular light from the main light, lightdir is from the surface to the light
+vec4 mainLight(vec3 lightdir, vec3 N, vec3 V, vec4 diffusecolour, vec4 specularcolour)
+{
+	float distancetolight = length(lightdir);
+	vec3 L = lightdir / distancetolight;
+
+	//Calculate diffuse component
+	vec4 diffuse = max(dot(N,L), 0.0) * diffusecolour;
+
+	//Calculate specular component
+	vec3 R = reflect(-L, N);
+	vec4 specular = pow(max(dot(R,V), 0.0), shininess) * specularcolour;
+
+	//Calculate attenuation using different parameters to make it look more realistic
+	float attenuation_factor = 1.0 / (attenuation.x + attenuation.y * distancetolight + attenuation.z * distancetolight * distancetolight);
+
+	//calculate diffuse component based on the attenuation and the specular colour with some tweaks to make it more realistic
+	diffuse = diffuse + (pow(attenuation_factor, 2.5) * specularcolour)/2.5;
+
+	return lightVisibility(-lightdir) * attenuation_factor * (diffuse + specular * 0.6);
+}
+
+// Ambient term of a surface, the same in every light
+vec4 ambientColour(vec4 diffusecolour, vec4 specularcolour)
+{
+	vec4 ambient = diffusecolour * 0.15 + specularcolour * 0.25;
+	return vec4(pow(ambient.rgb, vec3(1.75)), 1.0);
+}
@@ -0,0 +1,22 @@
+// Point lights, moved into view space on the CPU, see lightclusters.h
+// Needs frame.glsl for the shininess and attenuation constants
+layout(binding = 1) uniform samplerBuffer lightdata;		// View space position and radius, then colour
+
+// Diffuse and specular light from point light number light
+vec3 pointLight(int light, vec3 position, vec3 N, vec3 V, vec3 diffusecolour, vec3 specularcolour)
+{
+	vec4 positionradius = texelFetch(lightdata, light * 2);
+	vec3 colour = texelFetch(lightdata, light * 2 + 1).rgb;
+
+	vec3 tolight = positionradius.xyz - position;
+	float d = length(tolight);
+	vec3 L = tolight / d;
+
+	// Same attenuation as the main light, faded to nothing at the light's radius
+	float window = clamp(1.0 - (d * d) / (positionradius.w * positionradius.w), 0.0, 1.0);
+	float falloff = window * window / (attenuation.x + attenuation.y * d + attenuation.z * d * d);
+
+	float diffuse = max(dot(N, L), 0.0);
+	float specular = pow(max(dot(reflect(-L, N), V), 0.0), shininess);
+	return falloff * colour * (diffuse * diffusecolour + specular * 0.6 * specularcolour);
+}
@@ -0,0 +1,14 @@
+//Shadow map fragment shader, stores the distance from the light rather than the face's depth
+//so the lookup in shadow.glsl does not need to know which face it lands on
+//Andres Alvarez Olmo
+
+#version 420 core
+
+#include "frame.glsl"
+
+in vec3 fromlight;
+
+void main()
+{
+	gl_FragDepth = length(fromlight) * shadowparams.x;
+}
@@ -0,0 +1,15 @@
+// Shadows of the main light from the cached cube shadow map, see shadowcubemap.h
+// Needs frame.glsl for the view matrix and the shadow terms
+layout(binding = 7) uniform samplerCubeShadow shadowmap;	// Distance to the nearest caster / far plane
+
+// How much of the main light reaches a point, fromlight is from the light to it in view space
+float lightVisibility(vec3 fromlight)
+{
+	if (shadowparams.z == 0.0)
+		return 1.0;
+
+	// The cube map faces are in world space. The view matrix only rotates and moves, so its
+	// transpose undoes the rotation
+	vec3 direction = transpose(mat3(view)) * fromlight;
+	return texture(shadowmap, vec4(direction, length(fromlight) * shadowparams.x - shadowparams.y));
+}
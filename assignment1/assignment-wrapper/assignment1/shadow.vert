@@ -0,0 +1,22 @@
+//Shadow map vertex shader, draws the casters into one face of the cube shadow map
+//Andres Alvarez Olmo
+
+#version 420 core
+
+layout(location = 0) in vec3 position;
+
+uniform mat4 model;
+uniform mat4 facematrix;		// Projection and view of the face
+uniform vec3 shadowlight;		// World space
+
+#include "frame.glsl"
+#include "animation.glsl"
+
+out vec3 fromlight;
+
+void main()
+{
+	vec4 world = spinWorld(model * vec4(position, 1.0), spinRotation());
+	fromlight = world.xyz - shadowlight;
+	gl_Position = facematrix * world;
+}
@@ -7,21 +7,28 @@
 #version 420 core
 
 
-// Define the vertex attributes
+// Define the vertex attributes. Positions, normals and colours can be packed as
+// normalised integers (see packedvertex.h), they arrive here already converted to floats
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 colour;
 layout(location = 2) in vec3 normal;
 
+#include "colours.glsl"
+
 // Outputs to send to the fragment shader
 out vec3 fnormal;
 out vec3 flightdir, fposition;
-out vec4 fdiffusecolour;
+out vec4 fdiffusecolour, fambientcolour;
+
+// Must give exactly the same depth as depth.vert for the depth pre-pass
+invariant gl_Position;
 
-//Uniforms defined in the application
-uniform mat4 model, view, projection;
+//Uniforms defined in the application. The camera and light are in the Frame block
+#include "frame.glsl"
+#include "lighting.glsl"
+#include "animation.glsl"
+uniform mat4 model;
 uniform mat3 normalmatrix;
-uniform uint colourmode;
-uniform vec4 lightpos;
 
 void main()
 {
@@ -30,10 +37,18 @@ void main()
 
 	fdiffusecolour = colour;
 
-	mat4 mv_matrix = view * model;
-	fposition = (mv_matrix * position_h).xyz;
-	fnormal = normalize(normalmatrix* normal);
+	// The ambient colour only depends on the vertex colour, so work out the pow() here
+	// once per vertex rather than for every fragment
+	fambientcolour = ambientColour(colour, specular_colour[COLOURMODE]);
+
+	// Spinning parts are turned here rather than in their model matrix, see spin.h. The
+	// normal matrix is in view space, so the spin is moved into view space for the normal
+	mat3 spin = spinRotation();
+	vec4 world = spinWorld(model * position_h, spin);
+	mat3 viewrotation = mat3(view);
+	fposition = (view * world).xyz;
+	fnormal = normalize(viewrotation * spin * transpose(viewrotation) * (normalmatrix * normal));
 	flightdir = light_pos3 - fposition;
 
-	gl_Position = (projection * view * model) * position_h;
+	gl_Position = (projection * view) * world;
 }
\ No newline at end of file
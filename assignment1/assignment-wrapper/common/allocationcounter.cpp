@@ -0,0 +1,89 @@
+/* allocationcounter.cpp
+ Replaces the global operator new and delete to count heap allocations
+ Andres Alvarez Olmo 2021
+*/
+
+#include "allocationcounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static atomic<size_t> allocations(0);
+
+/* Plain bool so it needs no construction, operator new can run before anything else */
+static thread_local bool tracked = false;
+
+void AllocationCounter::track()
+{
+	tracked = true;
+}
+
+size_t AllocationCounter::count()
+{
+	return allocations.load(memory_order_relaxed);
+}
+
+static void *allocate(size_t size)
+{
+	if (tracked)
+		allocations.fetch_add(1, memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void *operator new(size_t size)
+{
+	void *p = allocate(size);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	void *p = allocate(size);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void *operator new(size_t size, const nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void *operator new[](size_t size, const nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, const nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, const nothrow_t&) noexcept
+{
+	free(p);
+}
@@ -0,0 +1,21 @@
+/* allocationcounter.h
+ Counts heap allocations made through operator new by the threads that ask to be tracked,
+ e.g. the render thread and the worker pool, so a frame can check it did not touch the heap.
+ Global operator new and delete are replaced in allocationcounter.cpp to do the counting.
+ Other threads (the shader watcher, driver threads) are not counted
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include <cstddef>
+
+class AllocationCounter
+{
+public:
+	/* Count the allocations made by the calling thread from now on */
+	static void track();
+
+	/* Allocations made so far by every tracked thread */
+	static size_t count();
+};
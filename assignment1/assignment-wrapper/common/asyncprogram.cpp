@@ -0,0 +1,190 @@
+/* asyncprogram.cpp
+ Non-blocking shader program builds
+ Andres Alvarez Olmo 2021
+*/
+
+#include "asyncprogram.h"
+#include "programcache.h"
+#include <iostream>
+
+using namespace std;
+
+/* GL_KHR_parallel_shader_compile and GL_ARB_parallel_shader_compile share these values.
+   Our glload headers predate them so they are declared and loaded here */
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (CODEGEN_FUNCPTR *MaxShaderCompilerThreadsProc)(GLuint count);
+
+/* Set once enableParallelCompile() finds the extension, otherwise completion is not queried */
+static bool parallelcompile = false;
+
+AsyncProgram::AsyncProgram() : program(0), state(IDLE), vertexshader(0), fragmentshader(0)
+{
+}
+
+/* Like the mesh buffers, the shaders and program live until the context is destroyed */
+AsyncProgram::~AsyncProgram()
+{
+}
+
+bool AsyncProgram::enableParallelCompile()
+{
+	MaxShaderCompilerThreadsProc maxthreads = NULL;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		maxthreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		maxthreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+
+	if (!maxthreads)
+		return false;
+
+	// 0xFFFFFFFF lets the driver pick the number of threads
+	maxthreads(0xFFFFFFFF);
+	parallelcompile = true;
+	return true;
+}
+
+void AsyncProgram::compile(const string &vertexsource, const string &fragmentsource)
+{
+	release();
+	log.clear();
+
+	sources.clear();
+	sources.push_back(vertexsource);
+	sources.push_back(fragmentsource);
+
+	program = ProgramCache::load(sources);
+	if (program)
+	{
+		state = READY;
+		return;
+	}
+
+	/* Submit both stages before asking about either so the driver can work on them together */
+	const char *text = vertexsource.c_str();
+	vertexshader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexshader, 1, &text, NULL);
+	glCompileShader(vertexshader);
+
+	text = fragmentsource.c_str();
+	fragmentshader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentshader, 1, &text, NULL);
+	glCompileShader(fragmentshader);
+
+	state = COMPILING;
+}
+
+/* Without the extension there is no way to ask without waiting, so report everything as
+   complete and let the status query wait for it */
+bool AsyncProgram::completed(GLuint object, bool isprogram)
+{
+	if (!parallelcompile)
+		return true;
+
+	GLint status = GL_FALSE;
+	if (isprogram)
+		glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &status);
+	else
+		glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &status);
+	return status == GL_TRUE;
+}
+
+bool AsyncProgram::compiled(GLuint shader, const char *stage)
+{
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == GL_TRUE)
+		return true;
+
+	GLint length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+	vector<GLchar> info((length > 1) ? length : 1, '\0');
+	glGetShaderInfoLog(shader, (GLsizei)info.size(), NULL, &info[0]);
+	log += string("Compile error in ") + stage + "\n\t" + &info[0] + "\n";
+	return false;
+}
+
+bool AsyncProgram::poll()
+{
+	if (state == COMPILING)
+	{
+		if (!completed(vertexshader, false) || !completed(fragmentshader, false))
+			return false;
+
+		// Check both so the log has the errors from each stage
+		bool vertexok = compiled(vertexshader, "vertex");
+		bool fragmentok = compiled(fragmentshader, "fragment");
+		if (!vertexok || !fragmentok)
+		{
+			fail();
+			return true;
+		}
+
+		program = glCreateProgram();
+		glAttachShader(program, vertexshader);
+		glAttachShader(program, fragmentshader);
+		ProgramCache::retrievable(program);
+		glLinkProgram(program);
+		state = LINKING;
+	}
+
+	if (state == LINKING)
+	{
+		if (!completed(program, true))
+			return false;
+
+		GLint status;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status == GL_FALSE)
+		{
+			GLint length = 0;
+			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			vector<GLchar> info((length > 1) ? length : 1, '\0');
+			glGetProgramInfoLog(program, (GLsizei)info.size(), NULL, &info[0]);
+			log += string("Linker error: ") + &info[0] + "\n";
+			fail();
+			return true;
+		}
+
+		glDeleteShader(vertexshader);
+		glDeleteShader(fragmentshader);
+		vertexshader = fragmentshader = 0;
+
+		ProgramCache::save(sources, program);
+		state = READY;
+	}
+
+	return state != COMPILING && state != LINKING;
+}
+
+GLuint AsyncProgram::detach()
+{
+	GLuint built = (state == READY) ? program : 0;
+	if (built)
+		program = 0;
+	release();
+	return built;
+}
+
+void AsyncProgram::fail()
+{
+	cerr << log;
+	release();
+	state = FAILED;
+}
+
+void AsyncProgram::release()
+{
+	if (vertexshader)
+		glDeleteShader(vertexshader);
+	if (fragmentshader)
+		glDeleteShader(fragmentshader);
+	if (program)
+		glDeleteProgram(program);
+
+	vertexshader = fragmentshader = program = 0;
+	state = IDLE;
+}
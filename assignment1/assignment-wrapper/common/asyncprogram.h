@@ -0,0 +1,60 @@
+/* asyncprogram.h
+ Builds a shader program without blocking the frame loop. Both stages are submitted to the
+ driver before any status is queried, and with GL_KHR_parallel_shader_compile (or the ARB
+ version) poll() only looks at the completion status so it never waits for the compiler.
+ Draw with a simple fallback program until ready() and then switch over
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <string>
+#include <vector>
+
+class AsyncProgram
+{
+public:
+	AsyncProgram();
+	~AsyncProgram();
+
+	/* Let the driver compile on its own threads. Call once after the context is created,
+	   returns false if the extension is missing and compiles happen when polled instead */
+	static bool enableParallelCompile();
+
+	/* Start building the program. Uses the program binary cache when it can, in which case
+	   the program is ready straight away */
+	void compile(const std::string &vertexsource, const std::string &fragmentsource);
+
+	/* Advance the build without blocking. Returns true once it has finished, successfully or not */
+	bool poll();
+
+	bool ready() const { return state == READY; }
+	bool failed() const { return state == FAILED; }
+
+	/* The built program, or fallback while it is still compiling or if it failed */
+	GLuint get(GLuint fallback) const { return (state == READY) ? program : fallback; }
+
+	/* Hand the built program over to the caller, who deletes it when done with it.
+	   Leaves this object idle, ready to compile() the next version */
+	GLuint detach();
+
+	GLuint program;
+	std::string log;	// Compile or link errors if it failed
+
+private:
+	AsyncProgram(const AsyncProgram&) = delete;
+	AsyncProgram& operator=(const AsyncProgram&) = delete;
+
+	enum State { IDLE, COMPILING, LINKING, READY, FAILED };
+
+	static bool completed(GLuint object, bool isprogram);
+	bool compiled(GLuint shader, const char *stage);
+	void fail();
+	void release();
+
+	State state;
+	GLuint vertexshader;
+	GLuint fragmentshader;
+	std::vector<std::string> sources;	// Kept to save the binary once linked
+};
@@ -0,0 +1,172 @@
+/* commandbuffer.cpp
+ Draw commands recorded off the context thread and replayed on it
+ Andres Alvarez Olmo 2021
+*/
+
+#include "commandbuffer.h"
+#include <algorithm>
+#include <new>
+
+using namespace std;
+using namespace glm;
+
+CommandBuffer::CommandBuffer() : used(0), hasmesh(false), hasmaterial(false)
+{
+}
+
+CommandBuffer::~CommandBuffer()
+{
+}
+
+void CommandBuffer::reset()
+{
+	used = 0;
+	hasmesh = hasmaterial = false;
+}
+
+/* Bytes a command takes up, rounded up so the next one is aligned too */
+template<class Command> static size_t footprint()
+{
+	return (sizeof(Command) + sizeof(GLuint64) - 1) / sizeof(GLuint64) * sizeof(GLuint64);
+}
+
+/* Room for the next command. The memory only grows while the scene does, after that a frame
+   records into the same memory as the last */
+template<class Command> Command &CommandBuffer::push()
+{
+	const size_t size = footprint<Command>();
+	if (used + size > memory.size() * sizeof(GLuint64))
+		memory.resize(std::max(memory.size() * 2, (used + size) / sizeof(GLuint64)));
+
+	Command *command = new ((char*)&memory[0] + used) Command;
+	used += size;
+	return *command;
+}
+
+void CommandBuffer::program(GLuint program)
+{
+	ProgramCommand &command = push<ProgramCommand>();
+	command.type = PROGRAM;
+	command.program = program;
+}
+
+void CommandBuffer::transform(const mat4 &model, const mat3 &normalmatrix, const Spin &spin)
+{
+	TransformCommand &command = push<TransformCommand>();
+	command.type = TRANSFORM;
+	command.model = model;
+	command.normalmatrix = normalmatrix;
+	command.spin = spin;
+}
+
+void CommandBuffer::mesh(const MeshBinding &binding)
+{
+	MeshCommand &command = push<MeshCommand>();
+	command.type = MESH;
+	command.binding = binding;
+}
+
+void CommandBuffer::material(const vec4 &colour, GLenum polygonmode)
+{
+	MaterialCommand &command = push<MaterialCommand>();
+	command.type = MATERIAL;
+	command.polygonmode = polygonmode;
+	command.colour = colour;
+}
+
+void CommandBuffer::draw(GLenum primitive, bool indexed, GLuint first, GLuint count, GLuint instances)
+{
+	DrawCommand &command = push<DrawCommand>();
+	command.type = DRAW;
+	command.primitive = primitive;
+	command.indexed = indexed;
+	command.first = first;
+	command.count = count;
+	command.instances = instances;
+}
+
+void CommandBuffer::draw(const MeshDraw &meshdraw, int drawmode, GLuint level)
+{
+	if (!hasmesh || meshdraw.binding != lastmesh)
+	{
+		/* The constant colour only carries over to a mesh that reads it from the same attribute */
+		if (hasmesh && (lastmesh.colour.size || meshdraw.binding.colour.size ||
+			lastmesh.colour.location != meshdraw.binding.colour.location))
+			hasmaterial = false;
+
+		mesh(meshdraw.binding);
+		lastmesh = meshdraw.binding;
+		hasmesh = true;
+	}
+
+	GLenum polygonmode = MeshDraw::polygonMode(drawmode);
+	if (!hasmaterial || meshdraw.colour != lastcolour || polygonmode != lastpolygonmode)
+	{
+		material(meshdraw.colour, polygonmode);
+		lastcolour = meshdraw.colour;
+		lastpolygonmode = polygonmode;
+		hasmaterial = true;
+	}
+
+	/* Points are drawn from every vertex, not through the index buffer */
+	if (drawmode == 2)
+		draw(GL_POINTS, false, 0, meshdraw.numvertices);
+	else
+		draw(GL_TRIANGLES, meshdraw.binding.elementbuffer != 0, meshdraw.lods.first[level], meshdraw.lods.numindices[level]);
+}
+
+void CommandBuffer::replay(ProgramBinder bind, GLuint overrideprogram) const
+{
+	CommandUniforms uniforms;
+	const MeshBinding *mesh = 0;
+	if (overrideprogram)
+		bind(overrideprogram, uniforms);
+
+	const char *next = (const char*)memory.data(), *end = next + used;
+	while (next < end)
+	{
+		switch (*(const GLuint*)next)
+		{
+		case PROGRAM:
+		{
+			const ProgramCommand &command = *(const ProgramCommand*)next;
+			if (!overrideprogram)
+				bind(command.program, uniforms);
+			next += footprint<ProgramCommand>();
+			break;
+		}
+		case TRANSFORM:
+		{
+			const TransformCommand &command = *(const TransformCommand*)next;
+			glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, &command.model[0][0]);
+			glUniformMatrix3fv(uniforms.normalmatrix, 1, GL_FALSE, &command.normalmatrix[0][0]);
+			command.spin.setUniforms(uniforms.spinaxis, uniforms.spinpivot);
+			next += footprint<TransformCommand>();
+			break;
+		}
+		case MESH:
+		{
+			const MeshCommand &command = *(const MeshCommand*)next;
+			MeshDraw::bind(command.binding);
+			mesh = &command.binding;
+			next += footprint<MeshCommand>();
+			break;
+		}
+		case MATERIAL:
+		{
+			const MaterialCommand &command = *(const MaterialCommand*)next;
+			MeshDraw::setMaterial(*mesh, command.colour, command.polygonmode);
+			next += footprint<MaterialCommand>();
+			break;
+		}
+		case DRAW:
+		{
+			const DrawCommand &command = *(const DrawCommand*)next;
+			MeshDraw::drawRange(*mesh, command.primitive, command.indexed != 0, command.first,
+				command.count, command.instances);
+			next += footprint<DrawCommand>();
+			break;
+		}
+		}
+	}
+}
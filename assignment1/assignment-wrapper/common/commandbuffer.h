@@ -0,0 +1,113 @@
+/* commandbuffer.h
+ Compact list of draw commands recorded without any GL calls, so the work of turning the scene
+ into draws (choosing programs, working out normal matrices) can run on worker threads while
+ only the context thread talks to GL. Each buffer is its own linear allocator: commands are
+ written one after another into a block of memory that is kept from frame to frame, recording
+ one is a bump of the write position and reset() throws them all away at once.
+ The context thread then replays the buffers in order. The commands are
+	program		make a program current, the shaders of the draws that follow
+	transform	model matrix, normal matrix and spin of the draws that follow
+	mesh		bind a mesh's vertex buffer, vertex layout and index buffer
+	material	constant colour and polygon mode of the draws that follow
+	draw		draw a range of the bound mesh, as one or more instances
+ Recording a MeshDraw leaves out the mesh and material commands when they are the same as the
+ last ones, so the sorted draws of one mesh only bind it once
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "spin.h"
+#include "meshdraw.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+/* Locations of the uniforms the commands set in the current program, -1 if it has none */
+struct CommandUniforms
+{
+	GLint model, normalmatrix, spinaxis, spinpivot;
+};
+
+class CommandBuffer
+{
+public:
+	/* Makes a program current on replay and finds its uniforms */
+	typedef void (*ProgramBinder)(GLuint program, CommandUniforms &uniforms);
+
+	CommandBuffer();
+	~CommandBuffer();
+
+	/* Forget the commands, keeping the memory for the next frame */
+	void reset();
+
+	void program(GLuint program);
+	void transform(const glm::mat4 &model, const glm::mat3 &normalmatrix, const Spin &spin);
+	void mesh(const MeshBinding &binding);
+	void material(const glm::vec4 &colour, GLenum polygonmode);
+	void draw(GLenum primitive, bool indexed, GLuint first, GLuint count, GLuint instances = 1);
+
+	/* Record what MeshDraw::draw() does, in a draw mode: 0 filled, 1 lines, 2 points */
+	void draw(const MeshDraw &meshdraw, int drawmode, GLuint level = 0);
+
+	/* Run the commands on the context thread. With an override program the program commands
+	   are skipped and everything is drawn with it, e.g. for a depth pre-pass */
+	void replay(ProgramBinder bind, GLuint overrideprogram = 0) const;
+
+	size_t bytes() const { return used; }
+
+private:
+	enum Type
+	{
+		PROGRAM, TRANSFORM, MESH, MATERIAL, DRAW
+	};
+
+	/* Every command starts with its type. They are packed one after another on 8 byte
+	   boundaries, see footprint() */
+	struct ProgramCommand
+	{
+		GLuint type;
+		GLuint program;
+	};
+
+	struct TransformCommand
+	{
+		GLuint type;
+		glm::mat4 model;
+		glm::mat3 normalmatrix;
+		Spin spin;
+	};
+
+	struct MeshCommand
+	{
+		GLuint type;
+		MeshBinding binding;
+	};
+
+	struct MaterialCommand
+	{
+		GLuint type;
+		GLenum polygonmode;
+		glm::vec4 colour;
+	};
+
+	struct DrawCommand
+	{
+		GLuint type;
+		GLenum primitive;
+		GLuint indexed;		// Through the bound index buffer, or straight from the vertices
+		GLuint first, count;
+		GLuint instances;
+	};
+
+	template<class Command> Command &push();
+
+	std::vector<GLuint64> memory;	// 8 byte units so the commands are aligned
+	size_t used;		// Bytes of memory holding commands
+
+	/* The last mesh and material recorded, to leave out repeats of them */
+	bool hasmesh, hasmaterial;
+	MeshBinding lastmesh;
+	glm::vec4 lastcolour;
+	GLenum lastpolygonmode;
+};
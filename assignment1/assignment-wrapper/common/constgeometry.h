@@ -0,0 +1,86 @@
+/* constgeometry.h
+ Compile time maths for the fixed geometry tables (cube, square, tetrahedron).
+ The glm vectors we ship are not constexpr, so small aggregates with the same layout as
+ glm::vec3 stand in for them. Tables built with these are static const data, their normals are
+ worked out by the compiler and the buffers are uploaded straight from them
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+
+struct ConstVec3
+{
+	GLfloat x, y, z;
+};
+
+constexpr ConstVec3 operator+(ConstVec3 a, ConstVec3 b) { return ConstVec3{ a.x + b.x, a.y + b.y, a.z + b.z }; }
+constexpr ConstVec3 operator-(ConstVec3 a, ConstVec3 b) { return ConstVec3{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+constexpr ConstVec3 operator*(ConstVec3 a, ConstVec3 b) { return ConstVec3{ a.x * b.x, a.y * b.y, a.z * b.z }; }
+constexpr ConstVec3 operator*(ConstVec3 a, GLfloat s) { return ConstVec3{ a.x * s, a.y * s, a.z * s }; }
+
+constexpr GLfloat constDot(ConstVec3 a, ConstVec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+constexpr ConstVec3 constCross(ConstVec3 a, ConstVec3 b)
+{
+	return ConstVec3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+/* Newton's method, converges to float precision well within 32 steps for the lengths used here */
+constexpr GLfloat constSqrt(GLfloat x)
+{
+	if (x <= 0.f)
+		return 0.f;
+
+	GLfloat r = x > 1.f ? x : 1.f;
+	for (int i = 0; i < 32; i++)
+		r = 0.5f * (r + x / r);
+	return r;
+}
+
+constexpr ConstVec3 constNormalize(ConstVec3 a)
+{
+	return a * (1.f / constSqrt(constDot(a, a)));
+}
+
+/* Same result as glm::packUnorm4x8 */
+constexpr glm::uint32 constPackColour(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+	return (glm::uint32)(r * 255.f + 0.5f) | ((glm::uint32)(g * 255.f + 0.5f) << 8)
+		| ((glm::uint32)(b * 255.f + 0.5f) << 16) | ((glm::uint32)(a * 255.f + 0.5f) << 24);
+}
+
+/* Corner of a flat shaded triangle, positions and normals interleaved */
+struct FlatVertex
+{
+	ConstVec3 position;
+	ConstVec3 normal;
+};
+
+template <size_t N>
+struct FlatTriangles
+{
+	FlatVertex vertices[N];
+};
+
+/* Give every corner of a triangle list the unit normal of its triangle */
+template <size_t N>
+constexpr FlatTriangles<N> flatShade(const ConstVec3 (&positions)[N])
+{
+	static_assert(N % 3 == 0, "flatShade needs whole triangles");
+
+	FlatTriangles<N> triangles = {};
+	for (size_t v = 0; v < N; v += 3)
+	{
+		ConstVec3 normal = constNormalize(constCross(positions[v + 1] - positions[v], positions[v + 2] - positions[v]));
+		for (size_t k = 0; k < 3; k++)
+		{
+			triangles.vertices[v + k].position = positions[v + k];
+			triangles.vertices[v + k].normal = normal;
+		}
+	}
+	return triangles;
+}
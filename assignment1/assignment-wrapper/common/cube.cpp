@@ -4,15 +4,105 @@
 */
 
 #include "cube.h"
+#include "packedvertex.h"
+#include "constgeometry.h"
+#include <string>
+#include <cstddef>
 
 using namespace std;
+using namespace glm;
+
+/* Saved with cached boxes on disk. Editing this file already rebuilds them (see
+   MeshFile::CodeStamp), bump it to rebuild them without touching the code */
+const GLuint BOX_VERSION = 1;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+/* One corner of one face of a box */
+struct BoxVertex
+{
+	ConstVec3 position;
+	ConstVec3 normal;
+	uint32 colour;		// RGBA8
+};
+
+struct BoxVertices
+{
+	BoxVertex vertices[24];
+};
+
+struct BoxIndices
+{
+	GLubyte indices[36];
+};
+
+/* Outward normal of each face and two axes across it, chosen so that axis_u x axis_v = normal
+   and the corners below go round anticlockwise when seen from outside */
+static constexpr ConstVec3 FACE_NORMALS[6] = { { 0, 0, -1 }, { 1, 0, 0 }, { 0, 0, 1 }, { -1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 } };
+static constexpr ConstVec3 FACE_AXIS_U[6] = { { 1, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 0, 0, 1 } };
+static constexpr ConstVec3 FACE_AXIS_V[6] = { { 0, -1, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } };
+static constexpr GLfloat CORNER_U[4] = { -1, 1, 1, -1 };
+static constexpr GLfloat CORNER_V[4] = { -1, -1, 1, 1 };
+
+/* Four vertices per face (so each face has its own normal and colour). Used by the compiler for
+   the default cube and at run time for other boxes */
+static constexpr BoxVertices boxVertices(ConstVec3 extents, const uint32 (&facecolours)[6])
+{
+	BoxVertices box = {};
+	ConstVec3 half = extents * 0.5f;
+	for (int f = 0; f < 6; f++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			BoxVertex &v = box.vertices[f * 4 + c];
+			v.position = (FACE_NORMALS[f] + FACE_AXIS_U[f] * CORNER_U[c] + FACE_AXIS_V[f] * CORNER_V[c]) * half;
+			v.normal = FACE_NORMALS[f];
+			v.colour = facecolours[f];
+		}
+	}
+	return box;
+}
+
+/* Two triangles per face, the same for every box */
+static constexpr BoxIndices boxIndices()
+{
+	BoxIndices box = {};
+	for (int f = 0; f < 6; f++)
+	{
+		GLubyte first = (GLubyte)(f * 4);
+		GLubyte face[6] = { first, (GLubyte)(first + 1), (GLubyte)(first + 2), first, (GLubyte)(first + 2), (GLubyte)(first + 3) };
+		for (int i = 0; i < 6; i++)
+			box.indices[f * 6 + i] = face[i];
+	}
+	return box;
+}
+
+/* The brown cube with a cream top and bottom used for the turntable base and stick */
+static constexpr uint32 BROWN = constPackColour(0.55f, 0.27f, 0.07f, 1.0f);
+static constexpr uint32 CREAM = constPackColour(0.96f, 0.91f, 0.70f, 1.0f);
+static constexpr uint32 CUBE_COLOURS[6] = { BROWN, BROWN, BROWN, BROWN, CREAM, CREAM };
+static constexpr ConstVec3 CUBE_EXTENTS = { 0.5f, 0.5f, 0.5f };
+
+static constexpr BoxVertices CUBE_VERTICES = boxVertices(CUBE_EXTENTS, CUBE_COLOURS);
+static constexpr BoxIndices BOX_INDICES = boxIndices();
+
+/* Boxes with the same size and colours share the same buffers */
+static string boxKey(ConstVec3 extents, const uint32 (&facecolours)[6])
+{
+	string key = "box:" + to_string(extents.x) + "," + to_string(extents.y) + "," + to_string(extents.z);
+	for (int f = 0; f < 6; f++)
+		key += ":" + to_string(facecolours[f]);
+	return key;
+}
 
 Cube::Cube()
 {
 	attribute_v_coord = 0;
 	attribute_v_colours = 1;
 	attribute_v_normal = 2;
-	numvertices = 12;
+	numvertices = 24;
+	numindices = 36;
+	indextype = GL_UNSIGNED_INT;
 }
 
 
@@ -21,176 +111,78 @@ Cube::~Cube()
 }
 
 
-/* Make a cube from hard-coded vertex positions and normals  */
+/* Make the cube on its own, uploading it straight away */
 void Cube::makeCube()
 {
-	/* Define vertices for a cube in 12 triangles */
-	GLfloat vertexPositions[] =
-	{
-		-0.25f, 0.25f, -0.25f,
-		-0.25f, -0.25f, -0.25f,
-		0.25f, -0.25f, -0.25f,
-
-		0.25f, -0.25f, -0.25f,
-		0.25f, 0.25f, -0.25f,
-		-0.25f, 0.25f, -0.25f,
-
-		0.25f, -0.25f, -0.25f,
-		0.25f, -0.25f, 0.25f,
-		0.25f, 0.25f, -0.25f,
-
-		0.25f, -0.25f, 0.25f,
-		0.25f, 0.25f, 0.25f,
-		0.25f, 0.25f, -0.25f,
-
-		0.25f, -0.25f, 0.25f,
-		-0.25f, -0.25f, 0.25f,
-		0.25f, 0.25f, 0.25f,
-
-		-0.25f, -0.25f, 0.25f,
-		-0.25f, 0.25f, 0.25f,
-		0.25f, 0.25f, 0.25f,
-
-		-0.25f, -0.25f, 0.25f,
-		-0.25f, -0.25f, -0.25f,
-		-0.25f, 0.25f, 0.25f,
-
-		-0.25f, -0.25f, -0.25f,
-		-0.25f, 0.25f, -0.25f,
-		-0.25f, 0.25f, 0.25f,
-
-		-0.25f, -0.25f, 0.25f,
-		0.25f, -0.25f, 0.25f,
-		0.25f, -0.25f, -0.25f,
-
-		0.25f, -0.25f, -0.25f,
-		-0.25f, -0.25f, -0.25f,
-		-0.25f, -0.25f, 0.25f,
-
-		-0.25f, 0.25f, -0.25f,
-		0.25f, 0.25f, -0.25f,
-		0.25f, 0.25f, 0.25f,
-
-		0.25f, 0.25f, 0.25f,
-		-0.25f, 0.25f, 0.25f,
-		-0.25f, 0.25f, -0.25f,
-	};
-
-	/* Manually specified colours for our cube */
-	float vertexColours[] = {
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-		0.55f, 0.27f, 0.07f, 1.0f,
-
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-		0.96f, 0.91f, 0.70f, 1.0f,
-	};
-
-	/* Manually specified normals for our cube */
-	GLfloat normals[] =
-	{
-		0, 0, -1.f, 0, 0, -1.f, 0, 0, -1.f,
-		0, 0, -1.f, 0, 0, -1.f, 0, 0, -1.f,
-		1.f, 0, 0, 1.f, 0, 0, 1.f, 0, 0,
-		1.f, 0, 0, 1.f, 0, 0, 1.f, 0, 0,
-		0, 0, 1.f, 0, 0, 1.f, 0, 0, 1.f,
-		0, 0, 1.f, 0, 0, 1.f, 0, 0, 1.f,
-		-1.f, 0, 0, -1.f, 0, 0, -1.f, 0, 0,
-		-1.f, 0, 0, -1.f, 0, 0, -1.f, 0, 0,
-		0, -1.f, 0, 0, -1.f, 0, 0, -1.f, 0,
-		0, -1.f, 0, 0, -1.f, 0, 0, -1.f, 0,
-		0, 1.f, 0, 0, 1.f, 0, 0, 1.f, 0,
-		0, 1.f, 0, 0, 1.f, 0, 0, 1.f, 0,
-	};
-
-	/* Create the vertex buffer for the cube */
-	glGenBuffers(1, &positionBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	/* Create the colours buffer for the cube */
-	glGenBuffers(1, &colourObject);
-	glBindBuffer(GL_ARRAY_BUFFER, colourObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexColours), vertexColours, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	/* Create the normals  buffer for the cube */
-	glGenBuffers(1, &normalsBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(normals), normals, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	MeshBuilder builder;
+	makeCube(builder);
+	builder.build();
+}
+
+
+/* Make the brown cube with a cream top and bottom. Its tables are built by the compiler
+   and uploaded straight from read only data */
+void Cube::makeCube(MeshBuilder &builder)
+{
+	MeshBlob blob;
+	blob.vertices = &CUBE_VERTICES;
+	blob.vertexbytes = sizeof(CUBE_VERTICES);
+	blob.numvertices = 24;
+	blob.vertexstride = sizeof(BoxVertex);
+	blob.indices = &BOX_INDICES;
+	blob.numindices = 36;
+	blob.indextype = GL_UNSIGNED_BYTE;
+	blob.lods = MeshLods::whole(36);
+
+	builder.add(boxKey(CUBE_EXTENTS, CUBE_COLOURS), blob,
+		[this](const MeshBuffers &mesh) { useBuffers(mesh); });
+}
+
+
+/* Queue the box mesh in builder. The buffers are filled in when builder.build() uploads it */
+void Cube::makeBox(vec3 extents, const vec4 facecolours[6], MeshBuilder &builder)
+{
+	ConstVec3 size = { extents.x, extents.y, extents.z };
+	uint32 colours[6];
+	for (int f = 0; f < 6; f++)
+		colours[f] = VertexPacking::packColour(facecolours[f]);
+
+	builder.add(boxKey(size, colours), BOX_VERSION,
+		[size, colours](MeshData &mesh) { defineBox(size, colours, mesh); },
+		[this](const MeshBuffers &mesh) { useBuffers(mesh); });
+}
+
+
+/* Take the uploaded buffers and describe the interleaved BoxVertex layout for drawing */
+void Cube::useBuffers(const MeshBuffers &mesh)
+{
+	vertexBufferObject = mesh.positions;
+	elementbuffer = mesh.elements;
+	indextype = mesh.indextype;
+
+	VertexAttribute position = { attribute_v_coord, 3, GL_FLOAT, GL_FALSE, offsetof(BoxVertex, position) };
+	VertexAttribute colour = { attribute_v_colours, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(BoxVertex, colour) };
+	VertexAttribute normal = { attribute_v_normal, 3, GL_FLOAT, GL_FALSE, offsetof(BoxVertex, normal) };
+	meshdraw.setBuffers(mesh.positions, mesh.elements, mesh.indextype, mesh.numvertices, mesh.lods);
+	meshdraw.binding.stride = sizeof(BoxVertex);
+	meshdraw.binding.position = position;
+	meshdraw.binding.colour = colour;
+	meshdraw.binding.normal = normal;
 }
 
 
-/* Draw the cube by bining the VBOs and drawing triangles */
+/* Fill mesh with the same tables as the default cube, worked out at run time */
+void Cube::defineBox(ConstVec3 extents, const uint32 (&facecolours)[6], MeshData &mesh)
+{
+	BoxVertices box = boxVertices(extents, facecolours);
+	mesh.setVertices(vector<BoxVertex>(box.vertices, box.vertices + 24));
+	mesh.indices.assign(BOX_INDICES.indices, BOX_INDICES.indices + 36);
+}
+
+
+/* Draw the cube by binding the interleaved VBO and drawing indexed triangles */
 void Cube::drawCube(int drawmode)
 {
-	/* Bind cube vertices. Note that this is in attribute index attribute_v_coord */
-	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
-	glEnableVertexAttribArray(attribute_v_coord);
-	glVertexAttribPointer(attribute_v_coord, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	/* Bind cube colours. Note that this is in attribute index attribute_v_colours */
-	glBindBuffer(GL_ARRAY_BUFFER, colourObject);
-	glEnableVertexAttribArray(attribute_v_colours);
-	glVertexAttribPointer(attribute_v_colours, 4, GL_FLOAT, GL_FALSE, 0, 0);
-
-	/* Bind cube normals. Note that this is in attribute index attribute_v_normal */
-	glEnableVertexAttribArray(attribute_v_normal);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsBufferObject);
-	glVertexAttribPointer(attribute_v_normal, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glPointSize(3.f);
-
-	// Switch between filled and wireframe modes
-	if (drawmode == 1)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	else
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Draw points
-	if (drawmode == 2)
-	{
-		glDrawArrays(GL_POINTS, 0, numvertices * 3);
-	}
-	else // Draw the cube in triangles
-	{
-		glDrawArrays(GL_TRIANGLES, 0, numvertices * 3);
-	}
+	/* Interleaved positions, colours and normals drawn as indexed triangles */
+	meshdraw.draw(drawmode);
 }
\ No newline at end of file
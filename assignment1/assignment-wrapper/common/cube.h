@@ -6,6 +6,9 @@ Iain Martin November 2018
 #pragma once
 
 #include "wrapper_glfw.h"
+#include "meshbuilder.h"
+#include "meshdraw.h"
+#include "constgeometry.h"
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -16,17 +19,32 @@ public:
 	~Cube();
 
 	void makeCube();
+	void makeCube(MeshBuilder &builder);
+
+	/* Make an indexed box with the given size along x, y and z and one colour per face.
+	   Faces are in the order -z, +x, +z, -x, -y, +y */
+	void makeBox(glm::vec3 extents, const glm::vec4 facecolours[6], MeshBuilder &builder);
 	void drawCube(int drawmode);
 
 	// Define vertex buffer object names (e.g as globals)
-	GLuint positionBufferObject;
-	GLuint colourObject;
-	GLuint normalsBufferObject;
+	// Positions, normals and colours are interleaved in one buffer shared by boxes with the same parameters
+	GLuint vertexBufferObject;
+	GLuint elementbuffer;
+	GLenum indextype;
 
 	GLuint attribute_v_coord;
 	GLuint attribute_v_normal;
 	GLuint attribute_v_colours;
 
 	int numvertices;
+	int numindices;
+
+	// Buffers and layout as data for the command buffers, see meshdraw.h
+	MeshDraw meshdraw;
+
+private:
+	void useBuffers(const MeshBuffers &mesh);
 
+	/* Generate the vertices and indices without any GL calls, so it can run on a worker thread */
+	static void defineBox(ConstVec3 extents, const glm::uint32 (&facecolours)[6], MeshData &mesh);
 };
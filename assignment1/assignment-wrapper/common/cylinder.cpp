@@ -4,14 +4,22 @@
 */
 
 #include "cylinder.h"
-const float PI = 3.141592653589f;  /* pi */
+#include "lathe.h"
+#include "packedvertex.h"
 
 #include <iostream>
 #include <cmath>
+#include <string>
 
 using namespace glm;
 using namespace std;
 
+/* Saved with cached cylinders on disk. Editing this file already rebuilds them (see
+   MeshFile::CodeStamp), bump it to rebuild them without touching the code */
+const GLuint CYLINDER_VERSION = 2;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
 Cylinder::Cylinder () : Cylinder(vec3(1.f, 1.f, 1.f))
 {
 	
@@ -29,168 +37,90 @@ Cylinder::Cylinder(vec3 c) : colour(c)
 
 	this->definition = 100;		
 	numberOfvertices = definition*4+2;
+	mixedCylinder = false;
+	cylinderColours = 0;
+	indextype = GL_UNSIGNED_INT;
 }
 
 Cylinder::~Cylinder()
 {
 }
 
+/* Make the cylinder on its own, generating and uploading it straight away */
 void Cylinder::makeCylinder(bool mixedCylinder)
 {
-	defineVertices(mixedCylinder);
-
-	GLuint pindices[406]; //204 //201
-	for (int i = 0; i < 101; i++)
-	{
-		pindices[i] = i;
-	}
-	pindices[101] = 1;
-	for (int i = 102; i < 203; i++)
-	{
-		pindices[i] = i -1;
-	}
-	pindices[203] = 102;
-
-	for (int i = 204; i < 404; i++)
-	{
-		pindices[i] = i - 2;
-	}
-	pindices[404] = 202;
-	pindices[405] = 203;
-	this->isize = (sizeof(pindices) / sizeof(*pindices));
-	glGenBuffers(1, &this->cylinderElementbuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->cylinderElementbuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, isize * sizeof(GLuint), pindices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	MeshBuilder builder;
+	makeCylinder(mixedCylinder, builder);
+	builder.build();
 }
-	//based on
-	//https://www.opengl.org/discussion_boards/showthread.php/167115-Creating-cylinder
-	void Cylinder::defineVertices(bool mixedCylinder)
-	{
-		vec3 vertices[402];
-		vec3 normals[402];
-		vec3 colour[402];
-
-		//number of pVertieces is total points * 3;
-		GLfloat halfLength = this->length / 2;
 
-		//define vertex at the center/top of the cylider
-		vertices[0] = vec3(0, halfLength, 0);
-		normals[0] = vec3(0.0, 1.0, 0.0);
-		colour[0] = this->colour;
-
-
-		//for every point around the circle
-		for (int i = 1; i < this->definition +1; i++)
+/* Queue the cylinder mesh in builder. The buffers are filled in when builder.build() uploads it */
+void Cylinder::makeCylinder(bool mixedCylinder, MeshBuilder &builder)
+{
+	/* Only mixed cylinders need a colour per vertex */
+	this->mixedCylinder = mixedCylinder;
+	if (mixedCylinder)
+		defineColours();
+
+	/* Cylinders that only differ in colour share the same buffers */
+	string key = "cylinder:" + to_string(definition);
+	GLuint definition = this->definition;
+	GLfloat radius = this->radius, length = this->length;
+	builder.add(key, CYLINDER_VERSION,
+		[definition, radius, length](MeshData &mesh) { defineCylinder(definition, radius, length, mesh); },
+		[this](const MeshBuffers &mesh)
 		{
-			GLfloat theta = (2 * PI) / this->definition * i;
-
-			GLfloat x = radius * cos(theta);
-			GLfloat y = halfLength;
-			GLfloat z = radius*sin(theta);
-
-			vertices[i] = vec3(x, y, z);
-			normals[i] = vec3(0.0, 1.0, 0.0);
+			cylinderBufferObject = mesh.positions;
+			cylinderElementbuffer = mesh.elements;
+			indextype = mesh.indextype;
+			isize = mesh.lods.numindices[0];
+
+			meshdraw.setBuffers(mesh.positions, mesh.elements, mesh.indextype, mesh.numvertices, mesh.lods);
+			VertexPacking::describe(attribute_v_coord, attribute_v_normal, meshdraw.binding);
+			meshdraw.binding.colour.location = attribute_v_colours;
+			if (this->mixedCylinder)
+			{
+				meshdraw.binding.colour = VertexPacking::colourAttribute(attribute_v_colours);
+				meshdraw.binding.colourbuffer = cylinderColours;
+			}
+			meshdraw.colour = vec4(colour, 1.f);
+		});
+}
 
-			//Draw pixels with number 99 and 100 in red, all of the rest draw them black
-			mixedCylinder ? (i <= 99) ?  colour[i] = this->colour : colour[i] = vec3(1, 0, 0) : colour[i] = this->colour;
-			
-		}
-		vertices[101] = vec3(0, -halfLength, 0);
-		normals[101] = vec3(0.0, -1.0, 0.0);
-		colour[101] = this->colour;
+/* Sweep the outline of the top lid, the side and the bottom lid round the axis. The corners are
+   repeated so the lids and the side have their own normals */
+void Cylinder::defineCylinder(GLuint definition, GLfloat radius, GLfloat length, MeshData &mesh)
+{
+	GLfloat halfLength = length / 2;
+	vector<ProfilePoint> profile = {
+		ProfilePoint(0.f, halfLength), ProfilePoint(radius, halfLength),
+		ProfilePoint(radius, halfLength), ProfilePoint(radius, -halfLength),
+		ProfilePoint(radius, -halfLength), ProfilePoint(0.f, -halfLength)
+	};
+
+	/* The rims are seams, they lose segments on the lids and the side together (see meshsimplifier.h).
+	   The simplifier doesn't see the colour buffer of mixed cylinders, so the notch is locked */
+	Lathe<PackedVertexFormat, SmoothNormals>::define(profile, definition, mesh, MeshLods::MAX_LEVELS,
+		vector<GLuint>(1, NOTCH_VERTEX));
+}
 
-		//for every point around the circle
-		for (int i = 102; i < (this->definition*2) + 2; i++)
-		{
-			GLfloat theta = (2 * PI) / this->definition * (i - 102);
-			
-			GLfloat x = radius * cos(theta);
-			GLfloat y = -halfLength;
-			GLfloat z = radius* sin(theta);
-
-			vertices[i] = vec3(x, y, z);
-			normals[i] = vec3(0.0, -1.0, 0.0);
-			colour[i] = this->colour;
-		}
-
-		//sides				202								402
-		int top = 1;
-		int bottom = 102;
-		for (int i = ((this->definition * 2) + 2); i < numberOfvertices; i += 2)
-		{
-			vertices[i] = vertices[top];
-			normals[i] = vec3(vertices[top].x, 0.0, vertices[top].z);
-			colour[i] = this->colour;
-			vertices[i + 1] = vertices[bottom];
-			normals[i + 1] = vec3(vertices[bottom].x, 0.0, vertices[bottom].z);
-			colour[i + 1] = this->colour;
-			top++;
-			bottom++;
-		}
-
-		/* Create the vertex buffer for the cylinder */
-		glGenBuffers(1, &this->cylinderBufferObject);
-		glBindBuffer(GL_ARRAY_BUFFER, this->cylinderBufferObject);
-		glBufferData(GL_ARRAY_BUFFER, (sizeof(vec3) * numberOfvertices), &vertices[0], GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	/* Colour buffer for mixed cylinders, which mark the top lid with a red notch */
+	void Cylinder::defineColours()
+	{
+		vector<uint32> colour(numberOfvertices, VertexPacking::packColour(vec4(this->colour, 1.f)));
 
-		glGenBuffers(1, &this->cylinderNormals);
-		glBindBuffer(GL_ARRAY_BUFFER, cylinderNormals);
-		glBufferData(GL_ARRAY_BUFFER, (sizeof(vec3) * numberOfvertices), &normals[0], GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		//Draw the top lid vertex at angle 0 (the first one after the centre) in red, all of the rest in the cylinder colour
+		colour[NOTCH_VERTEX] = VertexPacking::packColour(vec4(1, 0, 0, 1));
 
-		/* Store the colours in a buffer object */
+		/* Store the RGBA8 colours in a buffer object */
 		glGenBuffers(1, &this->cylinderColours);
 		glBindBuffer(GL_ARRAY_BUFFER, cylinderColours);
-		glBufferData(GL_ARRAY_BUFFER, (sizeof(vec3)* numberOfvertices), &colour[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, (sizeof(uint32)* numberOfvertices), &colour[0], GL_STATIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
 	void Cylinder::drawCylinder(int drawmode)
 	{
-		/* Bind the vertes positions */
-		glEnableVertexAttribArray(attribute_v_coord);
-		glBindBuffer(GL_ARRAY_BUFFER, cylinderBufferObject);
-		glVertexAttribPointer(attribute_v_coord, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		/* Bind the colours */
-		glEnableVertexAttribArray(attribute_v_colours);
-		glBindBuffer(GL_ARRAY_BUFFER, this->cylinderColours);
-		glVertexAttribPointer(attribute_v_colours, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		/* Bind the normals */
-		glEnableVertexAttribArray(attribute_v_normal);
-		glBindBuffer(GL_ARRAY_BUFFER, cylinderNormals);
-		glVertexAttribPointer(attribute_v_normal, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glPointSize(3.f);
-
-		// Enable this line to show model in wireframe
-		if (drawmode == 1)
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		else
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-		if (drawmode == 2)
-		{
-			glDrawArrays(GL_POINTS, 0, numberOfvertices);
-		}
-		else
-		{
-			int numfanvertices = definition + 2;
-			int numsidevertices = numfanvertices * 2;
-			int side_offset = definition * 2 + 2;
-			// Draw the cylinder using filled triangles
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->cylinderElementbuffer);
-
-			// Draw the top lid
-			glDrawElements(GL_TRIANGLE_FAN, numfanvertices, GL_UNSIGNED_INT, (GLvoid*)0);
-
-			// Draw the bottom lid
-			glDrawElements(GL_TRIANGLE_FAN, numfanvertices, GL_UNSIGNED_INT, (GLvoid*)(numfanvertices * sizeof(GLuint)));
-
-			// Draw the sides
-			glDrawElements(GL_TRIANGLE_STRIP, side_offset, GL_UNSIGNED_INT, (GLvoid*)(numsidevertices * sizeof(GLuint)));
-		}
+		/* Packed positions and normals, with the colour buffer of mixed cylinders or a constant colour */
+		meshdraw.draw(drawmode);
 	}
\ No newline at end of file
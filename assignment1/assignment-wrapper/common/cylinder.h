@@ -10,6 +10,9 @@
 #define CYLINDER_H
 
 #include "wrapper_glfw.h"
+#include "meshbuilder.h"
+#include "meshdraw.h"
+#include <vector>
 #include <glm/glm.hpp>
 
 class Cylinder
@@ -18,22 +21,34 @@ private:
 	glm::vec3 colour;
 	GLfloat radius, length;
 	GLuint definition;
-	GLuint cylinderBufferObject, cylinderNormals, cylinderColours, cylinderElementbuffer;
+	GLuint cylinderBufferObject, cylinderColours, cylinderElementbuffer;
+	bool mixedCylinder;		// Mixed cylinders have their own colour buffer, others use a constant colour
 	GLuint num_pvertices;
 	GLuint isize;
+	GLenum indextype;
 	GLuint numberOfvertices;
 
 	GLuint attribute_v_coord;
 	GLuint attribute_v_normal;
 	GLuint attribute_v_colours;
 
+	MeshDraw meshdraw;		// Buffers, layout and colour as data for the command buffers
+
+	/* Top lid vertex at angle 0, which mixed cylinders colour red. The levels of detail keep it */
+	static const GLuint NOTCH_VERTEX = 1;
+
+	/* Generate the vertices and indices without any GL calls, so it can run on a worker thread */
+	static void defineCylinder(GLuint definition, GLfloat radius, GLfloat length, MeshData &mesh);
+
 public:
 	Cylinder();
 	Cylinder(glm::vec3 c);
 	~Cylinder();
 	void makeCylinder(bool mixedCylinder);
-	void defineVertices(bool mixedCylinder);
+	void makeCylinder(bool mixedCylinder, MeshBuilder &builder);
+	void defineColours();
 	void drawCylinder(int drawmode);
+	const MeshDraw& meshDraw() const { return meshdraw; }
 };
 
 #endif
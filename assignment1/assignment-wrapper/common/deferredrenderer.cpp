@@ -0,0 +1,140 @@
+/* deferredrenderer.cpp
+ Deferred shading with a compact G-buffer and light volumes
+ Andres Alvarez Olmo 2021
+*/
+
+#include "deferredrenderer.h"
+#include "packedvertex.h"
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+/* Largest gap allowed between the light volume mesh and its sphere */
+const GLfloat VOLUME_ERROR = 0.05f;
+
+DeferredRenderer::DeferredRenderer() : framebuffer(0), albedotexture(0), normaltexture(0), depthtexture(0),
+	width(0), height(0), volumescale(1.f)
+{
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+}
+
+void DeferredRenderer::create()
+{
+	volume.makeIcosphere(Icosphere::levelsForError(VOLUME_ERROR), vec3(1.f));
+	volumescale = 1.f / (1.f - VOLUME_ERROR);
+}
+
+/* Make the G-buffer textures for a new viewport size. They are fetched texel by texel, so no
+   filtering or mipmaps */
+void DeferredRenderer::resize(GLuint newwidth, GLuint newheight)
+{
+	width = newwidth;
+	height = newheight;
+
+	if (!framebuffer)
+	{
+		GLuint textures[3];
+		glGenFramebuffers(1, &framebuffer);
+		glGenTextures(3, textures);
+		albedotexture = textures[0]; normaltexture = textures[1]; depthtexture = textures[2];
+	}
+
+	GLuint textures[3] = { albedotexture, normaltexture, depthtexture };
+	GLenum formats[3] = { GL_RGBA8, GL_RG16, GL_DEPTH_COMPONENT32F };
+	GLenum layouts[3] = { GL_RGBA, GL_RG, GL_DEPTH_COMPONENT };
+	GLenum types[3] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT };
+	for (int t = 0; t < 3; t++)
+	{
+		glBindTexture(GL_TEXTURE_2D, textures[t]);
+		glTexImage2D(GL_TEXTURE_2D, 0, formats[t], width, height, 0, layouts[t], types[t], NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedotexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normaltexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthtexture, 0);
+	GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, buffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cerr << "G-buffer framebuffer is incomplete" << endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DeferredRenderer::beginGeometry(GLuint newwidth, GLuint newheight)
+{
+	if (newwidth != width || newheight != height)
+		resize(newwidth, newheight);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	/* The cleared normal decodes to one facing the camera, a depth of 1 marks empty pixels */
+	const GLfloat albedo[4] = { 0.f, 0.f, 0.f, 0.f };
+	const GLfloat normal[4] = { 0.5f, 0.5f, 0.f, 0.f };
+	const GLfloat depth = 1.f;
+	glClearBufferfv(GL_COLOR, 0, albedo);
+	glClearBufferfv(GL_COLOR, 1, normal);
+	glClearBufferfv(GL_DEPTH, 0, &depth);
+	glEnable(GL_DEPTH_TEST);
+}
+
+void DeferredRenderer::light(GLuint lightprogram, GLuint volumeprogram, GLuint numpointlights)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GLuint units[3] = { ALBEDO_UNIT, NORMAL_UNIT, DEPTH_UNIT };
+	GLuint textures[3] = { albedotexture, normaltexture, depthtexture };
+	for (int t = 0; t < 3; t++)
+	{
+		glActiveTexture(GL_TEXTURE0 + units[t]);
+		glBindTexture(GL_TEXTURE_2D, textures[t]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	/* The passes read depth from the G-buffer, so they neither test nor write the window's.
+	   They are always filled, whatever mode the scene was drawn in */
+	glDisable(GL_DEPTH_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	/* The full screen triangle makes its corners from gl_VertexID */
+	for (GLuint a = 0; a < 3; a++)
+		glDisableVertexAttribArray(a);
+	glUseProgram(lightprogram);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	/* Drawing only the back faces of each volume lights every pixel behind its front once, and
+	   still works with the camera inside it. Depth clamping stops the far side of volumes that
+	   reach past the far plane being clipped away */
+	if (numpointlights > 0)
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_FRONT);
+		glEnable(GL_DEPTH_CLAMP);
+
+		glUseProgram(volumeprogram);
+		glUniform1f(glGetUniformLocation(volumeprogram, "volumescale"), volumescale);
+
+		glBindBuffer(GL_ARRAY_BUFFER, volume.positionBufferObject);
+		VertexPacking::setAttributes(volume.attribute_v_coord, volume.attribute_v_normal);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volume.elementbuffer);
+		glDrawElementsInstanced(GL_TRIANGLES, volume.numindices, volume.indextype, (GLvoid*)0, numpointlights);
+
+		glDisable(GL_DEPTH_CLAMP);
+		glCullFace(GL_BACK);
+		glDisable(GL_CULL_FACE);
+		glDisable(GL_BLEND);
+	}
+
+	glEnable(GL_DEPTH_TEST);
+}
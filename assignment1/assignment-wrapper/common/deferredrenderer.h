@@ -0,0 +1,50 @@
+/* deferredrenderer.h
+ Deferred shading path. The scene is drawn once into a compact single sample G-buffer:
+	albedo		RGBA8, diffuse colour with the emissive flag in alpha
+	normal		RG16, view space normal folded onto an octahedron (see gbuffer.glsl)
+	depth		32 bit float depth, the view space position is rebuilt from it
+ Lighting then runs in separate passes that read the G-buffer and write to the window: a full
+ screen triangle for the main, ambient and emissive light, then one instanced sphere per point
+ light, blended additively, which only shades the pixels the light can reach. Each pixel is
+ lit once however many samples the window has, so the lighting cost no longer scales with the
+ 8x MSAA of the forward path, at the cost of the edges of the lit image not being antialiased
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "icosphere.h"
+
+class DeferredRenderer
+{
+public:
+	/* Texture units of the G-buffer, set in gbuffer.glsl with layout(binding = n) */
+	static const GLuint ALBEDO_UNIT = 4;
+	static const GLuint NORMAL_UNIT = 5;
+	static const GLuint DEPTH_UNIT = 6;
+
+	DeferredRenderer();
+	~DeferredRenderer();
+
+	/* Create the light volume mesh. The G-buffer itself is made by the first beginGeometry() */
+	void create();
+
+	/* Bind and clear the G-buffer for drawing the scene with the gbuffer.frag programs, making
+	   it again first if the viewport has changed size */
+	void beginGeometry(GLuint width, GLuint height);
+
+	/* Light the G-buffer into the window with the deferred-light and deferred-volume programs,
+	   for the first numpointlights lights uploaded by LightClusters::uploadLights() */
+	void light(GLuint lightprogram, GLuint volumeprogram, GLuint numpointlights);
+
+	GLuint framebuffer;
+	GLuint albedotexture, normaltexture, depthtexture;
+	GLuint width, height;
+
+private:
+	void resize(GLuint width, GLuint height);
+
+	Icosphere volume;		// Unit sphere drawn around each point light
+	GLfloat volumescale;	// Grows the volume so its flat faces lie outside the true sphere
+};
@@ -0,0 +1,69 @@
+/* framearena.cpp
+ Double buffered per frame bump allocator
+ Andres Alvarez Olmo 2021
+*/
+
+#include "framearena.h"
+#include <cstdint>
+#include <new>
+
+using namespace std;
+
+FrameArena::FrameArena(size_t blocksize) : current(0)
+{
+	for (size_t b = 0; b < FRAMES; b++)
+	{
+		blocks[b].memory.resize(blocksize);
+		blocks[b].used = 0;
+		blocks[b].overflowbytes = 0;
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	for (size_t b = 0; b < FRAMES; b++)
+		for (size_t c = 0; c < blocks[b].overflow.size(); c++)
+			::operator delete(blocks[b].overflow[c]);
+}
+
+void FrameArena::beginFrame()
+{
+	current = (current + 1) % FRAMES;
+	Block &block = blocks[current];
+
+	/* Make the block big enough for everything it held last time round */
+	if (!block.overflow.empty())
+	{
+		for (size_t c = 0; c < block.overflow.size(); c++)
+			::operator delete(block.overflow[c]);
+		block.overflow.clear();
+		block.memory.resize(block.memory.size() + block.overflowbytes);
+		block.overflowbytes = 0;
+	}
+	block.used = 0;
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	Block &block = blocks[current];
+
+	uintptr_t start = (uintptr_t)block.memory.data() + block.used;
+	uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	size_t end = block.used + (size_t)(aligned - start) + bytes;
+	if (end <= block.memory.size())
+	{
+		block.used = end;
+		return (void*)aligned;
+	}
+
+	/* Out of room this frame. operator new aligns for any standard type */
+	void *chunk = ::operator new(bytes);
+	block.overflow.push_back((unsigned char*)chunk);
+	block.overflowbytes += bytes + alignment;
+	return chunk;
+}
+
+size_t FrameArena::used() const
+{
+	return blocks[current].used + blocks[current].overflowbytes;
+}
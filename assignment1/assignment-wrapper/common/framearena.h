@@ -0,0 +1,86 @@
+/* framearena.h
+ Linear (bump) allocator for data that only lives for a frame: the matrix stack and the draw
+ lists built in display(). Allocating moves a pointer along a block and nothing is freed on
+ its own; the whole block is reused at once a couple of frames later. There are two blocks, so
+ the lists of the frame before are still there while the next one is built (display() starts
+ sorting the draws from the last frame's order) and the frame after that reuses the block.
+ Nothing in the arena is handed to GL to read later, GL copies what it is given when called.
+ A frame that needs more than its block gets extra chunks from the heap, and the block is
+ grown to fit when it comes round again, so once the frames settle down they make no heap
+ allocations at all. ArenaAllocator lets standard containers allocate from the arena. The
+ arena is only used from the context thread, the worker threads record into their own
+ command buffers
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class FrameArena
+{
+public:
+	/* Frames whose data is kept at once: the one being built and the one before it */
+	static const size_t FRAMES = 2;
+
+	explicit FrameArena(size_t blocksize);
+	~FrameArena();
+
+	/* Start a new frame, throwing away the data of the frame FRAMES - 1 before this one */
+	void beginFrame();
+
+	/* Memory for this frame, aligned to alignment (a power of two) */
+	void *allocate(size_t bytes, size_t alignment);
+
+	/* Bytes allocated this frame */
+	size_t used() const;
+
+private:
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	struct Block
+	{
+		std::vector<unsigned char> memory;
+		size_t used;
+		std::vector<unsigned char*> overflow;	// Extra chunks when memory ran out
+		size_t overflowbytes;
+	};
+
+	Block blocks[FRAMES];
+	size_t current;
+};
+
+/* Standard allocator over a FrameArena, e.g. std::deque<T, ArenaAllocator<T> >. Freeing does
+   nothing, the memory goes when the arena reuses the frame's block */
+template<class T> class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	explicit ArenaAllocator(FrameArena &arena) : arena(&arena)
+	{
+	}
+
+	template<class U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena)
+	{
+	}
+
+	T *allocate(size_t n)
+	{
+		return (T*)arena->allocate(n * sizeof(T), alignof(T));
+	}
+
+	void deallocate(T*, size_t)
+	{
+	}
+
+	template<class U> bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+	template<class U> bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+
+	FrameArena *arena;
+};
+
+/* A list that lives for one frame, e.g. FrameVector<int> list((ArenaAllocator<int>(arena))) */
+template<class T> using FrameVector = std::vector<T, ArenaAllocator<T> >;
@@ -0,0 +1,36 @@
+/* frameblock.cpp
+ Per frame uniform buffer shared by every program
+ Andres Alvarez Olmo 2021
+*/
+
+#include "frameblock.h"
+
+static_assert(sizeof(FrameData) == 240, "FrameData must match the std140 layout of the Frame block");
+
+const GLuint FrameBlock::BINDING = 0;
+
+FrameBlock::FrameBlock() : buffer(0)
+{
+}
+
+FrameBlock::~FrameBlock()
+{
+}
+
+void FrameBlock::create()
+{
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+}
+
+void FrameBlock::update(const FrameData &data)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,49 @@
+/* frameblock.h
+ Uniform buffer holding everything that is the same for every draw in a frame: the camera,
+ the light and the lighting constants. It is worked out on the CPU and uploaded once per frame,
+ and every program reads it from the same binding point, so changing programs does not mean
+ setting these again and the fragment shader does not recompute them for every pixel.
+ FrameData must match the Frame block in frame.glsl, which uses std140 layout
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <glm/glm.hpp>
+
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 lightpos;			// View space
+	glm::vec4 attenuation;		// 1 / (x + y d + z d^2) for a distance d from the light, w unused
+	glm::vec4 globalambient;
+	GLfloat shininess;
+	GLfloat time;				// Seconds since start up, turns the spinning parts (see spin.h)
+	GLfloat padding[2];			// std140 starts the next vec4 on a 16 byte boundary
+	glm::vec4 clusterscale;		// Light cluster of a fragment, see lightclusters.h: x, y scale
+								// gl_FragCoord to tiles, the slice is log(depth) * z + w
+	glm::ivec4 clustercount;	// Tiles across and up, depth slices and number of lights
+	glm::vec4 shadowparams;		// 1 / far plane and depth bias of the shadow map (see shadowcubemap.h),
+								// z is 1 when shadows are on
+};
+
+class FrameBlock
+{
+public:
+	/* Binding point of the Frame block, set in the shaders with layout(binding = 0) */
+	static const GLuint BINDING;
+
+	FrameBlock();
+	~FrameBlock();
+
+	/* Create the buffer and attach it to the binding point */
+	void create();
+
+	/* Upload this frame's values. The old contents are orphaned so the driver does not wait
+	   for the previous frame to finish reading them */
+	void update(const FrameData &data);
+
+	GLuint buffer;
+};
@@ -0,0 +1,186 @@
+/* icosphere.cpp
+ Class to create a sphere by subdividing an icosahedron
+ Andres Alvarez Olmo 2021
+*/
+
+#include "icosphere.h"
+#include "meshoptimiser.h"
+#include "packedvertex.h"
+#include <cmath>
+#include <string>
+
+using namespace std;
+using namespace glm;
+
+/* Saved with cached icospheres on disk. Editing this file already rebuilds them (see
+   MeshFile::CodeStamp), bump it to rebuild them without touching the code */
+const GLuint ICOSPHERE_VERSION = 1;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+Icosphere::Icosphere()
+{
+	attribute_v_coord = 0;
+	attribute_v_colours = 1;
+	attribute_v_normal = 2;
+	numvertices = 0;		// Set in makeIcosphere once we know the number of levels
+	numindices = 0;
+	indextype = GL_UNSIGNED_INT;
+	levels = 0;
+}
+
+Icosphere::~Icosphere()
+{
+}
+
+/* Make the icosphere on its own, generating and uploading it straight away */
+void Icosphere::makeIcosphere(GLuint levels, vec3 colour)
+{
+	MeshBuilder builder;
+	makeIcosphere(levels, colour, builder);
+	builder.build();
+}
+
+/* Queue the icosphere mesh in builder. The buffers are filled in when builder.build() uploads it */
+void Icosphere::makeIcosphere(GLuint levels, vec3 colour, MeshBuilder &builder)
+{
+	this->levels = levels;
+	this->colour = vec4(colour, 1.f);
+
+	/* Icospheres that only differ in colour share the same buffers */
+	string key = "icosphere:" + to_string(levels);
+	builder.add(key, ICOSPHERE_VERSION,
+		[levels](MeshData &mesh) { defineIcosphere(levels, mesh); },
+		[this](const MeshBuffers &mesh)
+		{
+			positionBufferObject = mesh.positions;
+			elementbuffer = mesh.elements;
+			indextype = mesh.indextype;
+			numvertices = mesh.numvertices;
+			numindices = mesh.numindices;
+		});
+}
+
+/* Generate the icosphere. Each level splits every triangle into four, so a level n icosphere has
+ 20 * 4^n triangles and 10 * 4^n + 2 vertices */
+void Icosphere::defineIcosphere(GLuint levels, MeshData &mesh)
+{
+	/* The 12 vertices of an icosahedron are the corners of three orthogonal golden rectangles */
+	const GLfloat t = (1.f + sqrt(5.f)) / 2.f;
+
+	vector<vec3> vertices;
+	vertices.reserve(10 * (1 << (2 * levels)) + 2);
+	vertices.push_back(normalize(vec3(-1, t, 0)));
+	vertices.push_back(normalize(vec3(1, t, 0)));
+	vertices.push_back(normalize(vec3(-1, -t, 0)));
+	vertices.push_back(normalize(vec3(1, -t, 0)));
+	vertices.push_back(normalize(vec3(0, -1, t)));
+	vertices.push_back(normalize(vec3(0, 1, t)));
+	vertices.push_back(normalize(vec3(0, -1, -t)));
+	vertices.push_back(normalize(vec3(0, 1, -t)));
+	vertices.push_back(normalize(vec3(t, 0, -1)));
+	vertices.push_back(normalize(vec3(t, 0, 1)));
+	vertices.push_back(normalize(vec3(-t, 0, -1)));
+	vertices.push_back(normalize(vec3(-t, 0, 1)));
+
+	/* The 20 faces, wound anticlockwise when seen from outside */
+	vector<GLuint> &indices = mesh.indices;
+	indices = {
+		0, 11, 5,	0, 5, 1,	0, 1, 7,	0, 7, 10,	0, 10, 11,
+		1, 5, 9,	5, 11, 4,	11, 10, 2,	10, 7, 6,	7, 1, 8,
+		3, 9, 4,	3, 4, 2,	3, 2, 6,	3, 6, 8,	3, 8, 9,
+		4, 9, 5,	2, 4, 11,	6, 2, 10,	8, 6, 7,	9, 8, 1
+	};
+
+	/* Split every triangle into four, sharing the midpoint vertices between neighbouring triangles */
+	unordered_map<unsigned long long, GLuint> midpoints;
+	for (GLuint level = 0; level < levels; level++)
+	{
+		vector<GLuint> subdivided;
+		subdivided.reserve(indices.size() * 4);
+		midpoints.clear();
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			GLuint v0 = indices[i], v1 = indices[i + 1], v2 = indices[i + 2];
+			GLuint a = midpoint(v0, v1, vertices, midpoints);
+			GLuint b = midpoint(v1, v2, vertices, midpoints);
+			GLuint c = midpoint(v2, v0, vertices, midpoints);
+
+			GLuint tris[] = { v0, a, c,  v1, b, a,  v2, c, b,  a, b, c };
+			subdivided.insert(subdivided.end(), tris, tris + 12);
+		}
+		indices.swap(subdivided);
+	}
+
+	/* Reorder the triangles for the vertex cache and to reduce overdraw */
+	mesh.report = MeshOptimiser::optimise(indices, vertices);
+
+	/* Positions on a unit sphere are also its normals */
+	vector<PackedVertex> packed;
+	VertexPacking::pack(vertices, vertices, packed);
+	mesh.setVertices(packed);
+}
+
+/* Return the index of the vertex half way along edge (a, b), creating it the first time the edge is seen */
+GLuint Icosphere::midpoint(GLuint a, GLuint b, vector<vec3> &vertices, unordered_map<unsigned long long, GLuint> &midpoints)
+{
+	unsigned long long key = (a < b) ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+
+	unordered_map<unsigned long long, GLuint>::iterator found = midpoints.find(key);
+	if (found != midpoints.end())
+		return found->second;
+
+	GLuint index = (GLuint)vertices.size();
+	vertices.push_back(normalize((vertices[a] + vertices[b]) * 0.5f));
+	midpoints[key] = index;
+	return index;
+}
+
+/* The largest gap between a flat face and the sphere is at the face centre. For an equilateral
+ triangle with edge angle theta that is 1 - cos of the angle from the centre to a corner */
+GLuint Icosphere::levelsForError(GLfloat maxerror)
+{
+	const GLfloat icosahedron_edge_angle = 1.10715f;	// atan(2) radians
+	GLuint level = 0;
+	GLfloat edge_angle = icosahedron_edge_angle;
+
+	while (level < 8)
+	{
+		GLfloat corner_angle = asin(2.f * sin(edge_angle / 2.f) / sqrt(3.f));
+		if (1.f - cos(corner_angle) <= maxerror)
+			break;
+		edge_angle /= 2.f;
+		level++;
+	}
+	return level;
+}
+
+/* Draw the icosphere as one indexed triangle list */
+void Icosphere::drawIcosphere(int drawmode)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
+	VertexPacking::setAttributes(attribute_v_coord, attribute_v_normal);
+
+	/* The colour is the same for every vertex so send it as a constant attribute */
+	glDisableVertexAttribArray(attribute_v_colours);
+	glVertexAttrib4fv(attribute_v_colours, &colour[0]);
+
+	glPointSize(3.f);
+
+	// Switch between filled and wireframe modes
+	if (drawmode == 1)
+		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	else
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	if (drawmode == 2)
+	{
+		glDrawArrays(GL_POINTS, 0, numvertices);
+	}
+	else
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
+		glDrawElements(GL_TRIANGLES, numindices, indextype, (GLvoid*)0);
+	}
+}
@@ -0,0 +1,52 @@
+/* icosphere.h
+ Class to create a sphere by subdividing an icosahedron
+ Vertices are spread evenly over the surface (no clustering at the poles like the UV sphere)
+ and the whole mesh is a single indexed triangle list
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshbuilder.h"
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+class Icosphere
+{
+public:
+	Icosphere();
+	~Icosphere();
+
+	void makeIcosphere(GLuint levels, glm::vec3 colour);
+	void makeIcosphere(GLuint levels, glm::vec3 colour, MeshBuilder &builder);
+	void drawIcosphere(int drawmode);
+
+	/* Smallest number of subdivision levels whose maximum distance from the true unit sphere is below maxerror */
+	static GLuint levelsForError(GLfloat maxerror);
+
+	// Define vertex buffer object names, shared with other icospheres of the same level
+	GLuint positionBufferObject;
+	GLuint elementbuffer;
+	GLenum indextype;
+
+	// Single colour for the whole icosphere, set as a constant vertex attribute when drawing
+	glm::vec4 colour;
+
+	GLuint attribute_v_coord;
+	GLuint attribute_v_normal;
+	GLuint attribute_v_colours;
+
+	int numvertices;
+	int numindices;
+	int levels;
+
+private:
+	/* Generate the vertices and indices without any GL calls, so it can run on a worker thread */
+	static void defineIcosphere(GLuint levels, MeshData &mesh);
+
+	// midpoints holds the midpoints already created on an edge, keyed on the two (ordered) vertex indices of the edge
+	static GLuint midpoint(GLuint a, GLuint b, std::vector<glm::vec3> &vertices,
+		std::unordered_map<unsigned long long, GLuint> &midpoints);
+};
@@ -0,0 +1,69 @@
+/* indexbuffer.cpp
+ Uploads index buffers using the smallest index type that can address every vertex
+ Andres Alvarez Olmo 2021
+*/
+
+#include "indexbuffer.h"
+#include "meshfile.h"
+
+using namespace std;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+GLenum IndexBuffer::typeFor(GLuint numvertices)
+{
+	if (numvertices <= 0xFF + 1)
+		return GL_UNSIGNED_BYTE;
+	if (numvertices <= 0xFFFF + 1)
+		return GL_UNSIGNED_SHORT;
+	return GL_UNSIGNED_INT;
+}
+
+GLuint IndexBuffer::typeSize(GLenum indextype)
+{
+	switch (indextype)
+	{
+		case GL_UNSIGNED_BYTE: return sizeof(GLubyte);
+		case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+		default: return sizeof(GLuint);
+	}
+}
+
+/* Copy the indices into bytes of the narrower type T */
+template <typename T>
+static void narrowTo(const vector<GLuint> &indices, vector<unsigned char> &bytes)
+{
+	bytes.resize(indices.size() * sizeof(T));
+	T *out = reinterpret_cast<T*>(bytes.data());
+	for (size_t i = 0; i < indices.size(); i++)
+		out[i] = (T)indices[i];
+}
+
+void IndexBuffer::narrow(const vector<GLuint> &indices, GLuint numvertices, GLenum &indextype, vector<unsigned char> &bytes)
+{
+	indextype = typeFor(numvertices);
+
+	if (indextype == GL_UNSIGNED_BYTE)
+		narrowTo<GLubyte>(indices, bytes);
+	else if (indextype == GL_UNSIGNED_SHORT)
+		narrowTo<GLushort>(indices, bytes);
+	else
+		narrowTo<GLuint>(indices, bytes);
+}
+
+GLuint IndexBuffer::upload(const vector<GLuint> &indices, GLuint numvertices, GLenum &indextype)
+{
+	vector<unsigned char> bytes;
+	narrow(indices, numvertices, indextype, bytes);
+	return upload(bytes.data(), (GLuint)indices.size(), indextype);
+}
+
+GLuint IndexBuffer::upload(const void *indices, GLuint numindices, GLenum indextype)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)numindices * typeSize(indextype), indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	return buffer;
+}
@@ -0,0 +1,31 @@
+/* indexbuffer.h
+ Uploads index buffers using the smallest index type that can address every vertex
+ (GLubyte, GLushort or GLuint) so meshes with few vertices use less index memory and bandwidth
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <vector>
+
+class IndexBuffer
+{
+public:
+	/* Smallest index type for a mesh with numvertices vertices */
+	static GLenum typeFor(GLuint numvertices);
+
+	/* Size in bytes of one index of the given type */
+	static GLuint typeSize(GLenum indextype);
+
+	/* Copy the indices into bytes of the smallest type, without any GL calls.
+	   Sets indextype to the type to pass to glDrawElements */
+	static void narrow(const std::vector<GLuint> &indices, GLuint numvertices, GLenum &indextype, std::vector<unsigned char> &bytes);
+
+	/* Create a buffer holding the indices narrowed to the smallest type.
+	   Returns the buffer and sets indextype to the type to pass to glDrawElements */
+	static GLuint upload(const std::vector<GLuint> &indices, GLuint numvertices, GLenum &indextype);
+
+	/* Create a buffer from numindices indices that are already of type indextype */
+	static GLuint upload(const void *indices, GLuint numindices, GLenum indextype);
+};
@@ -0,0 +1,280 @@
+/* lathe.h
+ Generic generator for surfaces of revolution. A 2D profile is swept round the y axis and
+ turned into one indexed triangle list, optimised for the vertex cache, optionally followed
+ by coarser levels of detail of it.
+ The vertex format and the normal style are template parameters, so each combination is
+ compiled into its own generator and the loops over the vertices of a ring have no branches
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshbuilder.h"
+#include "meshoptimiser.h"
+#include "meshsimplifier.h"
+#include "packedvertex.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+/* A point on a profile: x is the distance from the axis and y the height along it.
+   Profiles run from the top of the surface to the bottom, so the normals face outwards.
+   Points with x of 0 are on the axis and become a single vertex (a pole or the centre of a lid).
+   Repeat a point to put a crease there */
+typedef glm::vec2 ProfilePoint;
+
+/* Vertex formats turn a position and normal into the vertex stored in the buffer */
+struct PackedVertexFormat
+{
+	typedef PackedVertex Vertex;
+	static Vertex make(const glm::vec3 &position, const glm::vec3 &normal) { return VertexPacking::pack(position, normal); }
+};
+
+/* Positions, normals and indices of a swept surface while it is built */
+struct LatheSurface
+{
+	GLuint segments;
+	std::vector<glm::vec2> directions;		// cos and sin of the angle of each segment
+	std::vector<glm::vec2> middirections;	// cos and sin half way across each segment
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+
+	/* Outward normal of the profile going from a to b, in the same (distance, height) plane */
+	static glm::vec2 profileNormal(glm::vec2 a, glm::vec2 b)
+	{
+		glm::vec2 d = b - a;
+		return glm::normalize(glm::vec2(-d.y, d.x));
+	}
+
+	GLuint addVertex(const glm::vec3 &position, const glm::vec3 &normal)
+	{
+		positions.push_back(position);
+		normals.push_back(normal);
+		return (GLuint)positions.size() - 1;
+	}
+
+	/* A ring of segments vertices sharing the profile point p and profile normal n */
+	GLuint addRing(glm::vec2 p, glm::vec2 n)
+	{
+		GLuint first = (GLuint)positions.size();
+		for (GLuint j = 0; j < segments; j++)
+		{
+			const glm::vec2 &dir = directions[j];
+			positions.push_back(glm::vec3(p.x * dir.x, p.y, p.x * dir.y));
+			normals.push_back(glm::vec3(n.x * dir.x, n.y, n.x * dir.y));
+		}
+		return first;
+	}
+
+	void addTriangle(GLuint a, GLuint b, GLuint c)
+	{
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+};
+
+/* Normals follow the profile and are shared by all the faces round a vertex, so the surface
+   is shaded smoothly except at repeated points, where each side gets its own vertices */
+struct SmoothNormals
+{
+	static void sweep(const std::vector<ProfilePoint> &profile, LatheSurface &surface)
+	{
+		size_t start = 0;
+		while (start < profile.size())
+		{
+			/* Each run between creases is a separate smooth surface */
+			size_t end = start + 1;
+			while (end < profile.size() && profile[end] != profile[end - 1])
+				end++;
+			sweepRun(profile, start, end, surface);
+			start = end;
+		}
+	}
+
+private:
+	static void sweepRun(const std::vector<ProfilePoint> &profile, size_t start, size_t end, LatheSurface &surface)
+	{
+		if (end - start < 2)
+			return;
+
+		std::vector<GLuint> first(end - start);
+		for (size_t i = start; i < end; i++)
+		{
+			/* Central difference along the profile, one-sided at the ends of the run */
+			glm::vec2 n = LatheSurface::profileNormal(profile[i > start ? i - 1 : i], profile[i + 1 < end ? i + 1 : i]);
+			glm::vec2 p = profile[i];
+
+			if (p.x == 0.f)
+				first[i - start] = surface.addVertex(glm::vec3(0.f, p.y, 0.f), glm::vec3(0.f, n.y < 0.f ? -1.f : 1.f, 0.f));
+			else
+				first[i - start] = surface.addRing(p, n);
+		}
+
+		for (size_t i = start; i + 1 < end; i++)
+		{
+			GLuint a = first[i - start], b = first[i + 1 - start];
+			bool apole = profile[i].x == 0.f, bpole = profile[i + 1].x == 0.f;
+			GLuint segments = surface.segments;
+
+			if (apole && bpole)
+				continue;
+			else if (apole)
+			{
+				for (GLuint j = 0; j < segments; j++)
+					surface.addTriangle(b + j, a, b + (j + 1) % segments);
+			}
+			else if (bpole)
+			{
+				for (GLuint j = 0; j < segments; j++)
+					surface.addTriangle(a + j, a + (j + 1) % segments, b);
+			}
+			else
+			{
+				for (GLuint j = 0; j < segments; j++)
+				{
+					GLuint next = (j + 1) % segments;
+					surface.addTriangle(a + j, a + next, b + j);
+					surface.addTriangle(b + j, a + next, b + next);
+				}
+			}
+		}
+	}
+};
+
+/* Every face has its own vertices and the normal of its plane, so the segments show as facets */
+struct FacetedNormals
+{
+	static void sweep(const std::vector<ProfilePoint> &profile, LatheSurface &surface)
+	{
+		GLuint segments = surface.segments;
+
+		/* The flat faces are closer to the axis than the profile by cos(half a segment) */
+		GLfloat chord = cos(3.14159265f / segments);
+
+		for (size_t i = 0; i + 1 < profile.size(); i++)
+		{
+			glm::vec2 a = profile[i], b = profile[i + 1];
+			if (a == b)
+				continue;
+
+			glm::vec2 n = LatheSurface::profileNormal(glm::vec2(a.x * chord, a.y), glm::vec2(b.x * chord, b.y));
+			bool apole = a.x == 0.f, bpole = b.x == 0.f;
+
+			if (apole && bpole)
+				continue;
+			else if (apole)
+			{
+				for (GLuint j = 0; j < segments; j++)
+				{
+					glm::vec3 normal = facetNormal(n, surface.middirections[j]);
+					GLuint v = surface.addVertex(point(b, surface.directions[j]), normal);
+					surface.addVertex(glm::vec3(0.f, a.y, 0.f), normal);
+					surface.addVertex(point(b, surface.directions[(j + 1) % segments]), normal);
+					surface.addTriangle(v, v + 1, v + 2);
+				}
+			}
+			else if (bpole)
+			{
+				for (GLuint j = 0; j < segments; j++)
+				{
+					glm::vec3 normal = facetNormal(n, surface.middirections[j]);
+					GLuint v = surface.addVertex(point(a, surface.directions[j]), normal);
+					surface.addVertex(point(a, surface.directions[(j + 1) % segments]), normal);
+					surface.addVertex(glm::vec3(0.f, b.y, 0.f), normal);
+					surface.addTriangle(v, v + 1, v + 2);
+				}
+			}
+			else
+			{
+				for (GLuint j = 0; j < segments; j++)
+				{
+					glm::vec3 normal = facetNormal(n, surface.middirections[j]);
+					const glm::vec2 &dir = surface.directions[j], &nextdir = surface.directions[(j + 1) % segments];
+					GLuint v = surface.addVertex(point(a, dir), normal);
+					surface.addVertex(point(a, nextdir), normal);
+					surface.addVertex(point(b, dir), normal);
+					surface.addVertex(point(b, nextdir), normal);
+					surface.addTriangle(v, v + 1, v + 2);
+					surface.addTriangle(v + 2, v + 1, v + 3);
+				}
+			}
+		}
+	}
+
+private:
+	static glm::vec3 point(glm::vec2 p, const glm::vec2 &dir)
+	{
+		return glm::vec3(p.x * dir.x, p.y, p.x * dir.y);
+	}
+
+	static glm::vec3 facetNormal(glm::vec2 n, const glm::vec2 &middir)
+	{
+		return glm::vec3(n.x * middir.x, n.y, n.x * middir.y);
+	}
+};
+
+/* Sweep a profile round the y axis in segments steps, e.g.
+   Lathe<PackedVertexFormat, SmoothNormals>::define(profile, 40, mesh) */
+template <typename Format, typename Normals>
+class Lathe
+{
+public:
+	/* Each level of detail keeps this much of the triangles of the level before */
+	static constexpr GLfloat LOD_RATIO = 0.25f;
+
+	/* Fill mesh with the swept surface and up to numlods - 1 coarser levels of detail, see
+	   MeshSimplifier::levelsOfDetail, which keep the locked vertices where they are. Only fills
+	   CPU arrays so it can run on a worker thread */
+	static void define(const std::vector<ProfilePoint> &profile, GLuint segments, MeshData &mesh, GLuint numlods = 1,
+		const std::vector<GLuint> &locked = std::vector<GLuint>())
+	{
+		LatheSurface surface;
+		surface.segments = segments;
+		surface.directions.resize(segments);
+		surface.middirections.resize(segments);
+		for (GLuint j = 0; j < segments; j++)
+		{
+			GLfloat angle = 2.f * 3.14159265f * j / segments;
+			GLfloat midangle = 2.f * 3.14159265f * (j + 0.5f) / segments;
+			surface.directions[j] = glm::vec2(cos(angle), sin(angle));
+			surface.middirections[j] = glm::vec2(cos(midangle), sin(midangle));
+		}
+
+		Normals::sweep(profile, surface);
+
+		std::vector<std::vector<GLuint> > levels;
+		std::vector<GLfloat> errors;
+		if (numlods > 1)
+		{
+			SimplifyMesh full;
+			full.positions = surface.positions;
+			full.normals = surface.normals;
+			full.indices = surface.indices;
+			full.locked = locked;
+			MeshSimplifier::levelsOfDetail(full, std::min(numlods, MeshLods::MAX_LEVELS) - 1, LOD_RATIO, levels, errors);
+		}
+
+		/* Reorder the triangles for the vertex cache and to reduce overdraw. The coarser levels
+		   follow the full mesh in the index buffer */
+		mesh.indices.swap(surface.indices);
+		mesh.report = MeshOptimiser::optimise(mesh.indices, surface.positions);
+		mesh.lods = MeshLods::whole((GLuint)mesh.indices.size());
+		for (size_t l = 0; l < levels.size(); l++)
+		{
+			MeshOptimiser::optimise(levels[l], surface.positions);
+			mesh.lods.add((GLuint)mesh.indices.size(), (GLuint)levels[l].size(), errors[l]);
+			mesh.indices.insert(mesh.indices.end(), levels[l].begin(), levels[l].end());
+			mesh.report += ", LOD " + std::to_string(l + 1) + ": " + std::to_string(levels[l].size() / 3) + " triangles";
+		}
+
+		std::vector<typename Format::Vertex> vertices(surface.positions.size());
+		for (size_t v = 0; v < vertices.size(); v++)
+			vertices[v] = Format::make(surface.positions[v], surface.normals[v]);
+		mesh.setVertices(vertices);
+	}
+};
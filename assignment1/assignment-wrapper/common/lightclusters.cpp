@@ -0,0 +1,197 @@
+/* lightclusters.cpp
+ Bins point lights into view frustum clusters for clustered forward lighting
+ Andres Alvarez Olmo 2021
+*/
+
+#include "lightclusters.h"
+#include "parallel.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace glm;
+
+/* Bin on worker threads from this many lights up */
+const size_t PARALLEL_LIGHTS = 256;
+
+LightClusters::LightClusters() : numassignments(0), maxtexels(65536),
+	databuffer(0), gridbuffer(0), indexbuffer(0), datatexture(0), gridtexture(0), indextexture(0)
+{
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+void LightClusters::create()
+{
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxtexels);
+
+	GLuint buffers[3], textures[3];
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+	databuffer = buffers[0]; gridbuffer = buffers[1]; indexbuffer = buffers[2];
+	datatexture = textures[0]; gridtexture = textures[1]; indextexture = textures[2];
+
+	// The textures stay attached to the buffers when their storage is replaced by upload()
+	GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	for (int b = 0; b < 3; b++)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[b]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[b]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[b], buffers[b]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	clusters.resize(TILES_X * TILES_Y * SLICES);
+	grid.resize(clusters.size());
+}
+
+/* A light is in column i if its sphere reaches past the plane on the left of the column and
+   does not lie wholly past the plane on its right. The planes go through the eye, so only
+   their x (or y) and z normal components are stored */
+static void tileRange(const vector<vec2> &planes, GLfloat across, GLfloat depth, GLfloat radius, GLuint &first, GLuint &last)
+{
+	GLuint tiles = (GLuint)planes.size() - 1;
+	first = tiles;
+	last = 0;
+	for (GLuint t = 0; t < tiles; t++)
+	{
+		GLfloat left = planes[t].x * across + planes[t].y * depth;
+		GLfloat right = planes[t + 1].x * across + planes[t + 1].y * depth;
+		if (left > -radius && right < radius)
+		{
+			first = std::min(first, t);
+			last = t;
+		}
+	}
+}
+
+/* Planes between the tiles, from the left (or bottom) edge of the view to the other edge */
+static void tilePlanes(GLuint tiles, GLfloat tanhalf, vector<vec2> &planes)
+{
+	planes.resize(tiles + 1);
+	for (GLuint t = 0; t <= tiles; t++)
+	{
+		GLfloat ndc = -1.f + 2.f * t / tiles;
+		planes[t] = normalize(vec2(1.f, ndc * tanhalf));
+	}
+}
+
+void LightClusters::update(const vector<PointLight> &lights, const mat4 &view, GLfloat fovy,
+	GLfloat nearplane, GLfloat farplane, GLuint width, GLuint height, FrameData &frame)
+{
+	GLfloat slicescale = SLICES / log(farplane / nearplane);
+
+	GLfloat tany = tan(fovy * 0.5f);
+	GLfloat tanx = tany * width / height;
+	tilePlanes(TILES_X, tanx, columnplanes);
+	tilePlanes(TILES_Y, tany, rowplanes);
+
+	uploadLights(lights, view);
+
+	/* Find the clusters each light reaches */
+	ranges.resize(lights.size());
+	for (size_t l = 0; l < lights.size(); l++)
+	{
+		vec4 position = lightdata[l * 2];
+		GLfloat radius = position.w;
+
+		ClusterRange &range = ranges[l];
+		range.z0 = 1;
+		range.z1 = 0;
+
+		GLfloat nearest = -position.z - radius, furthest = -position.z + radius;
+		if (furthest < nearplane || nearest > farplane)
+			continue;
+
+		nearest = std::max(nearest, nearplane);
+		furthest = std::min(furthest, farplane);
+		range.z0 = std::min((GLuint)(log(nearest / nearplane) * slicescale), SLICES - 1);
+		range.z1 = std::min((GLuint)(log(furthest / nearplane) * slicescale), SLICES - 1);
+
+		tileRange(columnplanes, position.x, position.z, radius, range.x0, range.x1);
+		tileRange(rowplanes, position.y, position.z, radius, range.y0, range.y1);
+		if (range.x0 > range.x1 || range.y0 > range.y1)
+			range.z0 = 1, range.z1 = 0;
+	}
+
+	/* Each slice owns its own clusters so the slices can be filled in on separate threads.
+	   With only a few lights starting the threads would cost more than the binning */
+	if (lights.size() >= PARALLEL_LIGHTS)
+		Parallel::forEach(SLICES, [this](size_t z) { slice((GLuint)z); });
+	else
+		for (GLuint z = 0; z < SLICES; z++)
+			slice(z);
+
+	/* Flatten the cluster lists into the grid and index list, within the texture buffer limit */
+	indices.clear();
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t count = std::min(clusters[c].size(), (size_t)maxtexels - indices.size());
+		grid[c] = uvec2((GLuint)indices.size(), (GLuint)count);
+		indices.insert(indices.end(), clusters[c].begin(), clusters[c].begin() + count);
+	}
+	numassignments = indices.size();
+	if (indices.empty())
+		indices.push_back(0);
+
+	upload(gridbuffer, &grid[0], grid.size() * sizeof(uvec2));
+	upload(indexbuffer, &indices[0], indices.size() * sizeof(GLuint));
+
+	/* The fragment shader finds its cluster from gl_FragCoord and its view space depth */
+	frame.clusterscale = vec4((GLfloat)TILES_X / width, (GLfloat)TILES_Y / height, slicescale, -log(nearplane) * slicescale);
+	frame.clustercount = ivec4(TILES_X, TILES_Y, SLICES, (GLint)lights.size());
+}
+
+void LightClusters::uploadLights(const vector<PointLight> &lights, const mat4 &view)
+{
+	lightdata.resize(std::max<size_t>(lights.size() * 2, 1));
+	for (size_t l = 0; l < lights.size(); l++)
+	{
+		lightdata[l * 2] = vec4(vec3(view * vec4(lights[l].position, 1.f)), lights[l].radius);
+		lightdata[l * 2 + 1] = vec4(lights[l].colour, 0.f);
+	}
+	upload(databuffer, &lightdata[0], lightdata.size() * sizeof(vec4));
+}
+
+/* Add every light that reaches slice z to the clusters of the slice */
+void LightClusters::slice(GLuint z)
+{
+	std::vector<GLuint> *first = &clusters[z * TILES_X * TILES_Y];
+	for (GLuint c = 0; c < TILES_X * TILES_Y; c++)
+		first[c].clear();
+
+	for (size_t l = 0; l < ranges.size(); l++)
+	{
+		const ClusterRange &range = ranges[l];
+		if (z < range.z0 || z > range.z1)
+			continue;
+
+		for (GLuint y = range.y0; y <= range.y1; y++)
+			for (GLuint x = range.x0; x <= range.x1; x++)
+				first[y * TILES_X + x].push_back((GLuint)l);
+	}
+}
+
+/* Orphan the old storage so the driver doesn't wait for the last frame to finish with it */
+void LightClusters::upload(GLuint buffer, const void *data, size_t bytes)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::bind()
+{
+	glActiveTexture(GL_TEXTURE0 + DATA_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, datatexture);
+	glActiveTexture(GL_TEXTURE0 + GRID_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, gridtexture);
+	glActiveTexture(GL_TEXTURE0 + INDEX_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, indextexture);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,81 @@
+/* lightclusters.h
+ Clustered forward lighting for many point lights. The view frustum is cut into a grid of
+ screen tiles and exponential depth slices, each light is binned into the clusters its sphere
+ of influence touches, and the fragment shader (clusters.glsl) only loops over the lights in
+ its own cluster. Binning runs on the CPU each frame, one depth slice per worker thread.
+ The results reach the shaders through three texture buffers:
+	light data		two RGBA32F texels per light, view space position and radius, then colour
+	light grid		RG32UI per cluster, offset and count of its lights in the index list
+	light indices	R32UI light numbers, cluster after cluster
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "frameblock.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+/* A light that only reaches as far as radius, in world space */
+struct PointLight
+{
+	glm::vec3 position;
+	GLfloat radius;
+	glm::vec3 colour;
+};
+
+class LightClusters
+{
+public:
+	/* Size of the cluster grid */
+	static const GLuint TILES_X = 16;
+	static const GLuint TILES_Y = 9;
+	static const GLuint SLICES = 24;
+
+	/* Texture units of the buffers, set in lights.glsl and clusters.glsl with layout(binding = n) */
+	static const GLuint DATA_UNIT = 1;
+	static const GLuint GRID_UNIT = 2;
+	static const GLuint INDEX_UNIT = 3;
+
+	LightClusters();
+	~LightClusters();
+
+	/* Create the buffers and textures */
+	void create();
+
+	/* Bin the lights for this camera and upload the results. fovy is in radians and width and
+	   height are the viewport size in pixels. Sets the cluster terms of frame */
+	void update(const std::vector<PointLight> &lights, const glm::mat4 &view, GLfloat fovy,
+		GLfloat nearplane, GLfloat farplane, GLuint width, GLuint height, FrameData &frame);
+
+	/* Only move the lights into view space and upload their data, without binning them, for
+	   passes that find the lights a fragment is in another way (see deferredrenderer.h) */
+	void uploadLights(const std::vector<PointLight> &lights, const glm::mat4 &view);
+
+	/* Bind the textures to their units */
+	void bind();
+
+	size_t numassignments;		// Light to cluster assignments made by the last update
+
+private:
+	/* Clusters a light touches in each direction, inclusive. Empty if z0 > z1 */
+	struct ClusterRange
+	{
+		GLuint x0, x1, y0, y1, z0, z1;
+	};
+
+	void slice(GLuint z);
+	void upload(GLuint buffer, const void *data, size_t bytes);
+
+	std::vector<ClusterRange> ranges;
+	std::vector<glm::vec2> columnplanes, rowplanes;
+	std::vector<std::vector<GLuint> > clusters;
+	std::vector<glm::vec4> lightdata;
+	std::vector<glm::uvec2> grid;
+	std::vector<GLuint> indices;
+	GLint maxtexels;
+
+	GLuint databuffer, gridbuffer, indexbuffer;
+	GLuint datatexture, gridtexture, indextexture;
+};
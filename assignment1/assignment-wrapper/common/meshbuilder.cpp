@@ -0,0 +1,140 @@
+/* meshbuilder.cpp
+ Parallel CPU generation and batched GL upload of meshes
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshbuilder.h"
+#include "indexbuffer.h"
+#include "parallel.h"
+#include <iostream>
+#include <cstring>
+#include <cassert>
+
+using namespace std;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+void MeshBuilder::add(const string &key, GLuint version, Generator generate, Attach attach)
+{
+	if (join(key, attach))
+		return;
+
+	Job job;
+	job.key = key;
+	job.version = version;
+	job.generate = generate;
+	memset(&job.blob, 0, sizeof(job.blob));
+	job.attach.push_back(attach);
+	jobs.push_back(job);
+}
+
+void MeshBuilder::add(const string &key, const MeshBlob &blob, Attach attach)
+{
+	assert(blob.indextype == IndexBuffer::typeFor(blob.numvertices));
+	assert(blob.vertexbytes == (size_t)blob.numvertices * blob.vertexstride);
+	assert(blob.lods.count > 0);
+	if (join(key, attach))
+		return;
+
+	Job job;
+	job.key = key;
+	job.version = 0;
+	job.blob = blob;
+	job.attach.push_back(attach);
+	jobs.push_back(job);
+}
+
+bool MeshBuilder::join(const string &key, const Attach &attach)
+{
+	MeshBuffers* mesh = MeshCache::find(key);
+	if (mesh)
+	{
+		attach(*mesh);
+		return true;
+	}
+
+	/* Several objects can ask for the same mesh before it is built, only generate it once */
+	for (size_t j = 0; j < jobs.size(); j++)
+	{
+		if (jobs[j].key == key)
+		{
+			jobs[j].attach.push_back(attach);
+			return true;
+		}
+	}
+	return false;
+}
+
+void MeshBuilder::build()
+{
+	if (jobs.empty())
+		return;
+
+	/* CPU phase, spread over the worker threads. A job maps the cache file for its mesh, or
+	   generates the mesh and writes the cache file for next time */
+	vector<MeshData> results(jobs.size());
+	vector<vector<unsigned char> > indexbytes(jobs.size());
+	vector<MeshFile> files(jobs.size());
+	vector<MeshBlob> blobs(jobs.size());
+	Parallel::forEach(jobs.size(), [&](size_t j)
+	{
+		if (!jobs[j].generate)
+		{
+			blobs[j] = jobs[j].blob;
+			return;
+		}
+
+		if (files[j].load(jobs[j].key, jobs[j].version))
+		{
+			blobs[j] = files[j].blob();
+			results[j].report = "loaded from the mesh cache";
+			return;
+		}
+
+		MeshData &data = results[j];
+		jobs[j].generate(data);
+
+		MeshBlob &blob = blobs[j];
+		IndexBuffer::narrow(data.indices, data.numvertices, blob.indextype, indexbytes[j]);
+		blob.vertices = data.vertices.data();
+		blob.vertexbytes = data.vertices.size();
+		blob.numvertices = data.numvertices;
+		blob.vertexstride = data.vertexstride;
+		blob.indices = indexbytes[j].data();
+		blob.numindices = (GLuint)data.indices.size();
+		blob.lods = data.lods.count ? data.lods : MeshLods::whole(blob.numindices);
+		MeshFile::save(jobs[j].key, jobs[j].version, blob);
+	});
+
+	/* Upload phase, on the GL thread, straight from the generated arrays or the mapped files */
+	vector<GLuint> vertexbuffers(jobs.size());
+	glGenBuffers((GLsizei)vertexbuffers.size(), &vertexbuffers[0]);
+
+	for (size_t j = 0; j < jobs.size(); j++)
+	{
+		const MeshBlob &blob = blobs[j];
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffers[j]);
+		glBufferData(GL_ARRAY_BUFFER, blob.vertexbytes, blob.vertices, GL_STATIC_DRAW);
+
+		MeshBuffers* mesh = MeshCache::insert(jobs[j].key);
+		mesh->positions = mesh->normals = vertexbuffers[j];
+		mesh->elements = IndexBuffer::upload(blob.indices, blob.numindices, blob.indextype);
+		mesh->indextype = blob.indextype;
+		mesh->numvertices = blob.numvertices;
+		mesh->vertexstride = blob.vertexstride;
+		mesh->numindices = blob.numindices;
+		mesh->lods = blob.lods;
+		mesh->users = (GLuint)jobs[j].attach.size();
+
+		if (!results[j].report.empty())
+			cout << jobs[j].key << ": " << results[j].report << endl;
+
+		for (size_t a = 0; a < jobs[j].attach.size(); a++)
+			jobs[j].attach[a](*mesh);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	/* The mapped files are closed here, once everything has been uploaded */
+	jobs.clear();
+}
@@ -0,0 +1,73 @@
+/* meshbuilder.h
+ Builds meshes in two phases: the generators only fill CPU arrays and run in parallel on worker
+ threads, then the results are uploaded together on the thread that owns the GL context.
+ Generated meshes are saved in the on-disk cache and later runs upload straight from the cache file
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshcache.h"
+#include "meshfile.h"
+#include <vector>
+#include <string>
+#include <functional>
+
+/* Output of a mesh generator. Generators must not make any GL calls */
+struct MeshData
+{
+	std::vector<unsigned char> vertices;	// Vertex buffer contents in the mesh's own vertex format
+	std::vector<GLuint> indices;
+	GLuint numvertices;
+	GLuint vertexstride;	// Bytes per vertex
+	MeshLods lods;			// Ranges of indices for each level of detail. Left empty it is one level of every index
+	std::string report;		// Optimiser statistics, printed once the mesh is uploaded
+
+	template <typename T>
+	void setVertices(const std::vector<T> &v)
+	{
+		const unsigned char *bytes = reinterpret_cast<const unsigned char*>(v.data());
+		vertices.assign(bytes, bytes + v.size() * sizeof(T));
+		numvertices = (GLuint)v.size();
+		vertexstride = sizeof(T);
+	}
+};
+
+class MeshBuilder
+{
+public:
+	typedef std::function<void(MeshData&)> Generator;
+	typedef std::function<void(const MeshBuffers&)> Attach;
+
+	/* Request the mesh stored under key. attach is called with its buffers once they exist: straight
+	   away if the mesh is already cached, otherwise from build(). generate only runs for the first
+	   request of each key. version is saved with the mesh on disk. Cache files are rebuilt
+	   when it changes and whenever the code that generated them is rebuilt, see MeshFile::CodeStamp */
+	void add(const std::string &key, GLuint version, Generator generate, Attach attach);
+
+	/* Request a mesh whose data is already in memory, e.g. a static table. build() uploads it
+	   straight from there, without generating it or saving it to disk. The indices must already
+	   be of the type IndexBuffer::typeFor picks for the number of vertices */
+	void add(const std::string &key, const MeshBlob &blob, Attach attach);
+
+	/* Load the queued meshes from the disk cache, or run their generators, on a pool of worker
+	   threads. Then upload every mesh on this thread and attach the buffers to the objects that
+	   asked for them */
+	void build();
+
+private:
+	struct Job
+	{
+		std::string key;
+		GLuint version;
+		Generator generate;		// Empty for meshes that are already in memory
+		MeshBlob blob;
+		std::vector<Attach> attach;
+	};
+
+	/* Add attach to an existing job for key. Returns false if there is no job for it yet */
+	bool join(const std::string &key, const Attach &attach);
+
+	std::vector<Job> jobs;
+};
@@ -0,0 +1,33 @@
+/* meshcache.cpp
+ Shares vertex and index buffers between objects generated with the same parameters
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshcache.h"
+
+using namespace std;
+
+map<string, MeshBuffers> MeshCache::meshes;
+
+MeshBuffers* MeshCache::find(const string &key)
+{
+	map<string, MeshBuffers>::iterator found = meshes.find(key);
+	if (found == meshes.end())
+		return NULL;
+
+	found->second.users++;
+	return &found->second;
+}
+
+/* Pointers into a std::map stay valid as more entries are added so callers can keep them */
+MeshBuffers* MeshCache::insert(const string &key)
+{
+	MeshBuffers &mesh = meshes[key];
+	mesh.positions = mesh.normals = mesh.elements = 0;
+	mesh.indextype = GL_UNSIGNED_INT;
+	mesh.numvertices = mesh.numindices = 0;
+	mesh.vertexstride = 0;
+	mesh.lods = MeshLods::whole(0);
+	mesh.users = 1;
+	return &mesh;
+}
@@ -0,0 +1,72 @@
+/* meshcache.h
+ Shares vertex and index buffers between objects generated with the same parameters
+ e.g. all spheres with the same numlats and numlongs use one set of buffers and only
+ differ in the colour they are drawn with
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <map>
+#include <string>
+
+/* Levels of detail of a mesh, all drawn from its one vertex buffer. Level 0 is the whole mesh
+   and each coarser level is a further range of the index buffer, see MeshSimplifier::levelsOfDetail */
+struct MeshLods
+{
+	static const GLuint MAX_LEVELS = 4;
+
+	GLuint count;
+	GLuint first[MAX_LEVELS];		// First index of each level
+	GLuint numindices[MAX_LEVELS];
+	GLfloat error[MAX_LEVELS];		// Furthest each level strays from level 0, in model space
+
+	/* A single level drawing numindices indices from the start */
+	static MeshLods whole(GLuint numindices)
+	{
+		MeshLods lods = MeshLods();
+		lods.count = 1;
+		lods.numindices[0] = numindices;
+		return lods;
+	}
+
+	/* Add the next coarser level. Levels past MAX_LEVELS are dropped */
+	void add(GLuint levelfirst, GLuint levelindices, GLfloat levelerror)
+	{
+		if (count == MAX_LEVELS)
+			return;
+		first[count] = levelfirst;
+		numindices[count] = levelindices;
+		error[count] = levelerror;
+		count++;
+	}
+};
+
+/* Buffer objects for one uploaded piece of geometry */
+struct MeshBuffers
+{
+	GLuint positions;
+	GLuint normals;		// Same as positions when they are interleaved in one buffer
+	GLuint elements;
+	GLenum indextype;	// Type of the indices in elements, narrowed to the vertex count
+	GLuint numvertices;
+	GLuint vertexstride;	// Bytes per vertex, tells apart the vertex formats of a generator
+	GLuint numindices;	// Of every level together
+	MeshLods lods;
+	GLuint users;		// Number of objects drawing with these buffers
+};
+
+class MeshCache
+{
+public:
+	/* Returns the buffers stored under key and registers another user, or NULL if
+	   nothing has been uploaded for that key yet */
+	static MeshBuffers* find(const std::string &key);
+
+	/* Creates an empty entry for key which the caller fills in after uploading */
+	static MeshBuffers* insert(const std::string &key);
+
+private:
+	static std::map<std::string, MeshBuffers> meshes;
+};
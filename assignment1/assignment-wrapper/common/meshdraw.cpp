@@ -0,0 +1,122 @@
+/* meshdraw.cpp
+ Binding and drawing of a mesh described by a MeshDraw
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshdraw.h"
+#include "indexbuffer.h"
+
+using namespace std;
+using namespace glm;
+
+bool VertexAttribute::operator==(const VertexAttribute &other) const
+{
+	return location == other.location && size == other.size && type == other.type &&
+		normalised == other.normalised && offset == other.offset;
+}
+
+bool MeshBinding::operator==(const MeshBinding &other) const
+{
+	return vertexbuffer == other.vertexbuffer && stride == other.stride && position == other.position &&
+		normal == other.normal && colour == other.colour && colourbuffer == other.colourbuffer &&
+		elementbuffer == other.elementbuffer && indextype == other.indextype;
+}
+
+MeshDraw::MeshDraw() : colour(1.f), numvertices(0), lods(MeshLods::whole(0))
+{
+	VertexAttribute none = { 0, 0, GL_FLOAT, GL_FALSE, 0 };
+	binding.vertexbuffer = 0;
+	binding.stride = 0;
+	binding.position = binding.normal = binding.colour = none;
+	binding.colourbuffer = 0;
+	binding.elementbuffer = 0;
+	binding.indextype = GL_UNSIGNED_INT;
+}
+
+void MeshDraw::setBuffers(GLuint vertexbuffer, GLuint elementbuffer, GLenum indextype, GLuint numvertices, const MeshLods &lods)
+{
+	binding.vertexbuffer = vertexbuffer;
+	binding.elementbuffer = elementbuffer;
+	binding.indextype = indextype;
+	this->numvertices = numvertices;
+	this->lods = lods;
+}
+
+GLuint MeshDraw::level(GLfloat maxerror) const
+{
+	/* The levels get coarser and their errors larger */
+	GLuint chosen = 0;
+	for (GLuint l = 1; l < lods.count && lods.error[l] <= maxerror; l++)
+		chosen = l;
+	return chosen;
+}
+
+void MeshDraw::draw(int drawmode, GLuint level) const
+{
+	bind(binding);
+	setMaterial(binding, colour, polygonMode(drawmode));
+
+	/* Points are drawn from every vertex, not through the index buffer */
+	if (drawmode == 2)
+		drawRange(binding, GL_POINTS, false, 0, numvertices, 1);
+	else
+		drawRange(binding, GL_TRIANGLES, binding.elementbuffer != 0, lods.first[level], lods.numindices[level], 1);
+}
+
+/* Point one attribute at the currently bound array buffer */
+static void setAttribute(const VertexAttribute &attribute, GLsizei stride)
+{
+	glEnableVertexAttribArray(attribute.location);
+	glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalised,
+		stride, (GLvoid*)(size_t)attribute.offset);
+}
+
+void MeshDraw::bind(const MeshBinding &binding)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, binding.vertexbuffer);
+	setAttribute(binding.position, binding.stride);
+	if (binding.normal.size)
+		setAttribute(binding.normal, binding.stride);
+	else
+		glDisableVertexAttribArray(binding.normal.location);
+
+	if (binding.colour.size)
+	{
+		if (binding.colourbuffer)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, binding.colourbuffer);
+			setAttribute(binding.colour, 0);
+		}
+		else
+			setAttribute(binding.colour, binding.stride);
+	}
+	else
+		glDisableVertexAttribArray(binding.colour.location);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, binding.elementbuffer);
+}
+
+void MeshDraw::setMaterial(const MeshBinding &binding, const vec4 &colour, GLenum polygonmode)
+{
+	/* Meshes with their own colours ignore the constant one */
+	if (!binding.colour.size)
+		glVertexAttrib4fv(binding.colour.location, &colour[0]);
+
+	glPointSize(3.f);
+	glPolygonMode(GL_FRONT_AND_BACK, polygonmode);
+}
+
+void MeshDraw::drawRange(const MeshBinding &binding, GLenum primitive, bool indexed, GLuint first,
+	GLuint count, GLuint instances)
+{
+	if (indexed)
+		glDrawElementsInstanced(primitive, count, binding.indextype,
+			(GLvoid*)((size_t)first * IndexBuffer::typeSize(binding.indextype)), instances);
+	else
+		glDrawArraysInstanced(primitive, first, count, instances);
+}
+
+GLenum MeshDraw::polygonMode(int drawmode)
+{
+	return drawmode == 1 ? GL_LINE : GL_FILL;
+}
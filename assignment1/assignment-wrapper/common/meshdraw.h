@@ -0,0 +1,68 @@
+/* meshdraw.h
+ How to draw an object's mesh, as plain data: the buffers and vertex layout to bind, the colour
+ and the ranges of the index buffer for each level of detail. The objects fill one in when their
+ mesh is built, the command buffers record it without calling back into the object, and the same
+ functions draw it straight away or on replay
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshcache.h"
+#include <glm/glm.hpp>
+
+/* One vertex attribute in a buffer. A size of 0 means the mesh doesn't have it */
+struct VertexAttribute
+{
+	GLuint location;
+	GLint size;
+	GLenum type;
+	GLboolean normalised;
+	GLuint offset;
+
+	bool operator==(const VertexAttribute &other) const;
+};
+
+/* Buffers and vertex layout of a mesh, everything that is bound before drawing it */
+struct MeshBinding
+{
+	GLuint vertexbuffer;
+	GLsizei stride;
+	VertexAttribute position, normal;
+	VertexAttribute colour;	// Per vertex colours, in colourbuffer if it isn't 0, else in vertexbuffer
+	GLuint colourbuffer;	// Tightly packed colours kept apart from the vertices, 0 if none
+	GLuint elementbuffer;	// 0 for meshes drawn straight from the vertices
+	GLenum indextype;
+
+	bool operator==(const MeshBinding &other) const;
+	bool operator!=(const MeshBinding &other) const { return !(*this == other); }
+};
+
+struct MeshDraw
+{
+	MeshDraw();
+
+	MeshBinding binding;
+	glm::vec4 colour;		// Constant colour for meshes without per vertex colours
+	GLuint numvertices;
+	MeshLods lods;			// Ranges of the index buffer (of the vertices without one) to draw as triangles
+
+	/* Use these buffers, drawing the levels of detail in lods */
+	void setBuffers(GLuint vertexbuffer, GLuint elementbuffer, GLenum indextype, GLuint numvertices, const MeshLods &lods);
+
+	/* Coarsest level of detail whose error covers at most maxerror model units */
+	GLuint level(GLfloat maxerror) const;
+
+	/* Draw with the current program in a draw mode: 0 filled, 1 lines, 2 points */
+	void draw(int drawmode, GLuint level = 0) const;
+
+	/* The steps of draw(), also used by command replay */
+	static void bind(const MeshBinding &binding);
+	static void setMaterial(const MeshBinding &binding, const glm::vec4 &colour, GLenum polygonmode);
+	static void drawRange(const MeshBinding &binding, GLenum primitive, bool indexed, GLuint first,
+		GLuint count, GLuint instances);
+
+	/* Polygon mode of a draw mode */
+	static GLenum polygonMode(int drawmode);
+};
@@ -0,0 +1,270 @@
+/* meshfile.cpp
+ On-disk cache of generated meshes, loaded with mmap (MapViewOfFile on Windows)
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshfile.h"
+#include "indexbuffer.h"
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const GLuint MeshFile::FORMAT_VERSION = 3;
+string MeshFile::directory = "meshcache";
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+/* Blobs start on a cache line boundary so they can be copied or DMAed straight from the mapping */
+const uint64_t BLOB_ALIGNMENT = 64;
+
+/* Fixed size header at the start of each file, followed by the key and then the blobs */
+struct MeshFileHeader
+{
+	char magic[4];			// "MESH"
+	uint32_t formatversion;
+	uint32_t generatorversion;
+	uint32_t keylength;		// The key is stored too, so a clash of file names is not mistaken for a hit
+	uint32_t numvertices;
+	uint32_t numindices;
+	uint32_t indextype;
+	uint32_t vertexstride;
+	uint64_t codehash;		// Build of the code that generated the mesh, see MeshFile::CodeStamp
+	uint64_t vertexoffset;
+	uint64_t vertexbytes;
+	uint64_t indexoffset;
+	uint64_t indexbytes;
+	uint32_t numlods;
+	uint32_t lodfirst[MeshLods::MAX_LEVELS];
+	uint32_t lodindices[MeshLods::MAX_LEVELS];
+	float loderror[MeshLods::MAX_LEVELS];
+};
+
+/* Every level of detail is a range inside the index buffer */
+static bool validLods(const MeshFileHeader &header)
+{
+	if (header.numlods < 1 || header.numlods > MeshLods::MAX_LEVELS)
+		return false;
+	for (uint32_t l = 0; l < header.numlods; l++)
+	{
+		if ((uint64_t)header.lodfirst[l] + header.lodindices[l] > header.numindices)
+			return false;
+	}
+	return true;
+}
+
+static uint64_t alignUp(uint64_t offset)
+{
+	return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+}
+
+MeshFile::MeshFile() : data(NULL), size(0)
+{
+	memset(&mapped, 0, sizeof(mapped));
+}
+
+MeshFile::~MeshFile()
+{
+	unmap();
+}
+
+/* Keys can contain characters that are not allowed in file names so name the file by a
+   hash of the key */
+string MeshFile::path(const string &key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)hash(key.data(), key.size(), HASH_SEED));
+	return directory + "/" + name;
+}
+
+bool MeshFile::load(const string &key, GLuint version)
+{
+	unmap();
+	if (directory.empty())
+		return false;
+
+	string filename = path(key);
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER filesize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &filesize) && filesize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+	{
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		size = data ? (size_t)filesize.QuadPart : 0;
+		CloseHandle(mapping);		// The view keeps the mapping alive
+	}
+	CloseHandle(file);
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		void *view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED)
+		{
+			data = (const unsigned char*)view;
+			size = (size_t)info.st_size;
+		}
+	}
+	close(file);		// The mapping stays valid after the file is closed
+#endif
+
+	if (!data)
+		return false;
+
+	/* Check the header before trusting any of the offsets in it */
+	MeshFileHeader header;
+	if (size < sizeof(header))
+	{
+		unmap();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	bool valid = memcmp(header.magic, "MESH", 4) == 0
+		&& header.formatversion == FORMAT_VERSION
+		&& header.generatorversion == version
+		&& header.codehash == codeHash()
+		&& header.keylength == key.size()
+		&& sizeof(header) + header.keylength <= size
+		&& memcmp(data + sizeof(header), key.data(), key.size()) == 0
+		&& header.vertexoffset % BLOB_ALIGNMENT == 0 && header.indexoffset % BLOB_ALIGNMENT == 0
+		&& header.vertexoffset + header.vertexbytes <= size
+		&& header.indexoffset + header.indexbytes <= size
+		&& header.vertexstride > 0
+		&& header.vertexbytes == (uint64_t)header.numvertices * header.vertexstride
+		&& header.indextype == IndexBuffer::typeFor(header.numvertices)
+		&& header.indexbytes == (uint64_t)header.numindices * IndexBuffer::typeSize(header.indextype)
+		&& validLods(header);
+	if (!valid)
+	{
+		unmap();
+		return false;
+	}
+
+	mapped.vertices = data + header.vertexoffset;
+	mapped.vertexbytes = (size_t)header.vertexbytes;
+	mapped.numvertices = header.numvertices;
+	mapped.vertexstride = header.vertexstride;
+	mapped.indices = data + header.indexoffset;
+	mapped.numindices = header.numindices;
+	mapped.indextype = header.indextype;
+	mapped.lods = MeshLods::whole(0);
+	for (uint32_t l = 0; l < header.numlods; l++)
+	{
+		mapped.lods.first[l] = header.lodfirst[l];
+		mapped.lods.numindices[l] = header.lodindices[l];
+		mapped.lods.error[l] = header.loderror[l];
+	}
+	mapped.lods.count = header.numlods;
+	return true;
+}
+
+bool MeshFile::save(const string &key, GLuint version, const MeshBlob &blob)
+{
+	if (directory.empty() || blob.vertexbytes != (size_t)blob.numvertices * blob.vertexstride)
+		return false;
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "MESH", 4);
+	header.formatversion = FORMAT_VERSION;
+	header.generatorversion = version;
+	header.keylength = (uint32_t)key.size();
+	header.numvertices = blob.numvertices;
+	header.numindices = blob.numindices;
+	header.indextype = blob.indextype;
+	header.vertexstride = blob.vertexstride;
+	header.codehash = codeHash();
+	header.vertexoffset = alignUp(sizeof(header) + key.size());
+	header.vertexbytes = blob.vertexbytes;
+	header.indexoffset = alignUp(header.vertexoffset + header.vertexbytes);
+	header.indexbytes = (uint64_t)blob.numindices * IndexBuffer::typeSize(blob.indextype);
+	header.numlods = blob.lods.count;
+	for (GLuint l = 0; l < blob.lods.count; l++)
+	{
+		header.lodfirst[l] = blob.lods.first[l];
+		header.lodindices[l] = blob.lods.numindices[l];
+		header.loderror[l] = blob.lods.error[l];
+	}
+	if (!validLods(header))
+		return false;
+
+	/* Write to a temporary file and rename it so a reader never maps a half written file */
+	string filename = path(key);
+	string temporary = filename + ".tmp";
+	{
+		ofstream out(temporary.c_str(), ios::binary | ios::trunc);
+		if (!out)
+			return false;
+
+		vector<char> padding(BLOB_ALIGNMENT, 0);
+		out.write((const char*)&header, sizeof(header));
+		out.write(key.data(), key.size());
+		out.write(&padding[0], header.vertexoffset - sizeof(header) - key.size());
+		out.write((const char*)blob.vertices, header.vertexbytes);
+		out.write(&padding[0], header.indexoffset - header.vertexoffset - header.vertexbytes);
+		out.write((const char*)blob.indices, header.indexbytes);
+		if (!out)
+		{
+			out.close();
+			remove(temporary.c_str());
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	bool renamed = MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool renamed = rename(temporary.c_str(), filename.c_str()) == 0;
+#endif
+	if (!renamed)
+		remove(temporary.c_str());
+	return renamed;
+}
+
+void MeshFile::unmap()
+{
+	if (data)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap((void*)data, size);
+#endif
+	}
+	data = NULL;
+	size = 0;
+	memset(&mapped, 0, sizeof(mapped));
+}
@@ -0,0 +1,97 @@
+/* meshfile.h
+ On-disk cache of generated meshes. Each mesh is one binary file holding a header with its
+ levels of detail and the vertex and index data, already in the layout the buffers want, at
+ aligned offsets. Loading maps the file into memory and the buffers are uploaded straight from
+ the mapping
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshcache.h"
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/* Vertex and index data of one mesh, pointing into memory owned by someone else */
+struct MeshBlob
+{
+	const void *vertices;
+	size_t vertexbytes;
+	GLuint numvertices;
+	GLuint vertexstride;	// Bytes per vertex, vertexbytes is always numvertices * vertexstride
+	const void *indices;
+	GLuint numindices;		// Of every level of detail together
+	GLenum indextype;
+	MeshLods lods;
+};
+
+class MeshFile
+{
+public:
+	/* Bump when the file layout changes */
+	static const GLuint FORMAT_VERSION;
+
+	/* Identifies the code the cached meshes were generated by. Every source file whose code
+	   shapes the cached data (generators, vertex packing, index optimisation, this file)
+	   declares one at file scope with its own compile time:
+	       static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+	   Editing any of them, or a header they include, recompiles it and so rebuilds the whole
+	   cache on the next run, without anyone having to remember to bump a version */
+	struct CodeStamp
+	{
+		CodeStamp(const char *file, const char *compiled)
+		{
+			codeHash() ^= hash(compiled, strlen(compiled), hash(file, strlen(file), HASH_SEED));
+		}
+	};
+
+	/* The stamps of every source file, combined so the order they register in doesn't matter */
+	static uint64_t& codeHash()
+	{
+		static uint64_t combined = 0;
+		return combined;
+	}
+
+	/* 64 bit FNV-1a, continuing from seed */
+	static const uint64_t HASH_SEED = 14695981039346656037ULL;
+	static uint64_t hash(const char *text, size_t length, uint64_t seed)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			seed ^= (unsigned char)text[i];
+			seed *= 1099511628211ULL;
+		}
+		return seed;
+	}
+
+	/* Directory holding the cache files. An empty string turns the cache off */
+	static std::string directory;
+
+	MeshFile();
+	~MeshFile();
+
+	/* Map the cache file for key and check it was written with the same format, generator
+	   version and build of the code. Returns false if there is no usable file and the mesh
+	   has to be generated */
+	bool load(const std::string &key, GLuint version);
+
+	/* The mapped mesh, valid until this object is destroyed */
+	const MeshBlob& blob() const { return mapped; }
+
+	/* Write the cache file for key. Failing only means the mesh is generated again next time */
+	static bool save(const std::string &key, GLuint version, const MeshBlob &blob);
+
+private:
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	static std::string path(const std::string &key);
+	void unmap();
+
+	const unsigned char *data;
+	size_t size;
+	MeshBlob mapped;
+};
@@ -0,0 +1,305 @@
+/* meshoptimiser.cpp
+ Vertex cache and overdraw optimisation of indexed triangle lists
+ Based on "Linear-Speed Vertex Cache Optimisation" by Tom Forsyth and the cluster sorting
+ from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" by Sander et al.
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshoptimiser.h"
+#include "meshfile.h"
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace glm;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+/* Size of the cache modelled when scoring vertices, and of the FIFO cache used for reporting.
+   16 entries is a conservative size for the post-transform cache of current hardware */
+const int SCORING_CACHE_SIZE = 32;
+const GLuint FIFO_CACHE_SIZE = 16;
+
+/* Score of a vertex from its position in the modelled LRU cache and the number of triangles
+   still to be drawn that use it. Vertices used by few remaining triangles are preferred so
+   that isolated triangles are not left until the end */
+static GLfloat vertexScore(int cacheposition, GLuint remaining)
+{
+	if (remaining == 0)
+		return -1.f;
+
+	GLfloat score = 0.f;
+	if (cacheposition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so we don't favour reusing them immediately
+		if (cacheposition < 3)
+			score = 0.75f;
+		else
+			score = pow(1.f - (cacheposition - 3) * (1.f / (SCORING_CACHE_SIZE - 3)), 1.5f);
+	}
+
+	score += 2.f * pow((GLfloat)remaining, -0.5f);
+	return score;
+}
+
+void MeshOptimiser::optimiseVertexCache(vector<GLuint> &indices, GLuint numvertices)
+{
+	size_t numtriangles = indices.size() / 3;
+	if (numtriangles == 0)
+		return;
+
+	/* Build the list of triangles using each vertex */
+	vector<GLuint> remaining(numvertices, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+		remaining[indices[i]]++;
+
+	vector<GLuint> offsets(numvertices + 1, 0);
+	for (GLuint v = 0; v < numvertices; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	vector<GLuint> adjacency(indices.size());
+	vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency[fill[indices[i]]++] = (GLuint)(i / 3);
+
+	vector<int> cacheposition(numvertices, -1);
+	vector<GLfloat> vscore(numvertices);
+	for (GLuint v = 0; v < numvertices; v++)
+		vscore[v] = vertexScore(-1, remaining[v]);
+
+	vector<GLfloat> tscore(numtriangles);
+	for (size_t t = 0; t < numtriangles; t++)
+		tscore[t] = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+
+	vector<bool> emitted(numtriangles, false);
+	vector<GLuint> output;
+	output.reserve(indices.size());
+
+	vector<GLuint> cache, newcache;
+	cache.reserve(SCORING_CACHE_SIZE + 3);
+	newcache.reserve(SCORING_CACHE_SIZE + 3);
+
+	/* Start with the best triangle overall */
+	long best = (long)(max_element(tscore.begin(), tscore.end()) - tscore.begin());
+	size_t scanstart = 0;
+
+	while (output.size() < indices.size())
+	{
+		/* Nothing in the cache is connected to a triangle still to draw, take the next unused triangle */
+		if (best < 0)
+		{
+			while (emitted[scanstart])
+				scanstart++;
+			best = (long)scanstart;
+		}
+
+		GLuint tri[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+		output.insert(output.end(), tri, tri + 3);
+		emitted[best] = true;
+
+		/* Remove the triangle from the adjacency of its vertices */
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = tri[k];
+			GLuint *list = &adjacency[offsets[v]];
+			for (GLuint a = 0; a < remaining[v]; a++)
+			{
+				if (list[a] == (GLuint)best)
+				{
+					list[a] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		/* Move the triangle's vertices to the front of the cache */
+		newcache.assign(tri, tri + 3);
+		for (size_t c = 0; c < cache.size(); c++)
+		{
+			if (cache[c] != tri[0] && cache[c] != tri[1] && cache[c] != tri[2])
+				newcache.push_back(cache[c]);
+		}
+
+		for (size_t c = 0; c < newcache.size(); c++)
+		{
+			GLuint v = newcache[c];
+			cacheposition[v] = (c < SCORING_CACHE_SIZE) ? (int)c : -1;
+			vscore[v] = vertexScore(cacheposition[v], remaining[v]);
+		}
+
+		/* Rescore the triangles touching the updated vertices and pick the best of those */
+		best = -1;
+		GLfloat bestscore = -1.f;
+		for (size_t c = 0; c < newcache.size(); c++)
+		{
+			GLuint v = newcache[c];
+			for (GLuint a = 0; a < remaining[v]; a++)
+			{
+				GLuint t = adjacency[offsets[v] + a];
+				tscore[t] = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+				if (tscore[t] > bestscore)
+				{
+					bestscore = tscore[t];
+					best = (long)t;
+				}
+			}
+		}
+
+		/* Vertices pushed past the end of the cache are evicted */
+		if (newcache.size() > SCORING_CACHE_SIZE)
+			newcache.resize(SCORING_CACHE_SIZE);
+		cache.swap(newcache);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimiser::optimiseOverdraw(vector<GLuint> &indices, const vector<vec3> &positions, GLfloat threshold)
+{
+	size_t numtriangles = indices.size() / 3;
+	if (numtriangles == 0)
+		return;
+
+	GLuint numvertices = (GLuint)positions.size();
+	GLfloat meshacmr = acmr(indices, numvertices, FIFO_CACHE_SIZE);
+
+	/* Split the triangle order into clusters. Each cluster is simulated from a cold cache and ends
+	   once its ACMR is within threshold of the whole mesh, so drawing the clusters in any order
+	   costs little vertex reuse */
+	vector<size_t> clusterstart;
+	vector<GLuint> timestamp(numvertices, 0);
+	GLuint time = FIFO_CACHE_SIZE + 1;
+	GLuint clustermisses = 0;
+	size_t clustertriangles = 0;
+
+	clusterstart.push_back(0);
+	for (size_t t = 0; t < numtriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = indices[t * 3 + k];
+			if (time - timestamp[v] > FIFO_CACHE_SIZE)
+			{
+				timestamp[v] = time++;
+				clustermisses++;
+			}
+		}
+		clustertriangles++;
+
+		if ((GLfloat)clustermisses / clustertriangles <= meshacmr * threshold && t + 1 < numtriangles)
+		{
+			clusterstart.push_back(t + 1);
+			clustermisses = 0;
+			clustertriangles = 0;
+			time += FIFO_CACHE_SIZE + 1;		// Empty the cache for the next cluster
+		}
+	}
+	clusterstart.push_back(numtriangles);
+
+	/* Area weighted centroid of the whole mesh */
+	vec3 meshcentroid(0.f);
+	GLfloat mesharea = 0.f;
+	for (size_t t = 0; t < numtriangles; t++)
+	{
+		const vec3 &p0 = positions[indices[t * 3]], &p1 = positions[indices[t * 3 + 1]], &p2 = positions[indices[t * 3 + 2]];
+		GLfloat area = length(cross(p1 - p0, p2 - p0));
+		meshcentroid += (p0 + p1 + p2) * (area / 3.f);
+		mesharea += area;
+	}
+	if (mesharea > 0.f)
+		meshcentroid /= mesharea;
+
+	/* Clusters facing away from the mesh centre are likely to occlude the others so draw them first */
+	size_t numclusters = clusterstart.size() - 1;
+	vector<pair<GLfloat, size_t> > order(numclusters);
+	for (size_t c = 0; c < numclusters; c++)
+	{
+		vec3 centroid(0.f), normal(0.f);
+		GLfloat area = 0.f;
+		for (size_t t = clusterstart[c]; t < clusterstart[c + 1]; t++)
+		{
+			const vec3 &p0 = positions[indices[t * 3]], &p1 = positions[indices[t * 3 + 1]], &p2 = positions[indices[t * 3 + 2]];
+			vec3 n = cross(p1 - p0, p2 - p0);
+			GLfloat a = length(n);
+			centroid += (p0 + p1 + p2) * (a / 3.f);
+			normal += n;
+			area += a;
+		}
+		if (area > 0.f)
+			centroid /= area;
+		if (length(normal) > 0.f)
+			normal = normalize(normal);
+
+		order[c] = make_pair(-dot(centroid - meshcentroid, normal), c);
+	}
+	stable_sort(order.begin(), order.end());
+
+	vector<GLuint> output;
+	output.reserve(indices.size());
+	for (size_t c = 0; c < numclusters; c++)
+	{
+		size_t cluster = order[c].second;
+		output.insert(output.end(), indices.begin() + clusterstart[cluster] * 3, indices.begin() + clusterstart[cluster + 1] * 3);
+	}
+	indices.swap(output);
+}
+
+/* Count the vertices transformed when drawing triangles first to last through a FIFO cache */
+GLuint MeshOptimiser::cacheMisses(const vector<GLuint> &indices, size_t first, size_t last, GLuint numvertices, GLuint cachesize)
+{
+	vector<GLuint> timestamp(numvertices, 0);
+	GLuint time = cachesize + 1;
+	GLuint misses = 0;
+
+	for (size_t i = first * 3; i < last * 3; i++)
+	{
+		GLuint v = indices[i];
+		if (time - timestamp[v] > cachesize)
+		{
+			timestamp[v] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+GLfloat MeshOptimiser::acmr(const vector<GLuint> &indices, GLuint numvertices, GLuint cachesize)
+{
+	size_t numtriangles = indices.size() / 3;
+	if (numtriangles == 0)
+		return 0.f;
+	return (GLfloat)cacheMisses(indices, 0, numtriangles, numvertices, cachesize) / numtriangles;
+}
+
+GLfloat MeshOptimiser::atvr(const vector<GLuint> &indices, GLuint numvertices, GLuint cachesize)
+{
+	if (numvertices == 0)
+		return 0.f;
+	return (GLfloat)cacheMisses(indices, 0, indices.size() / 3, numvertices, cachesize) / numvertices;
+}
+
+string MeshOptimiser::optimise(vector<GLuint> &indices, const vector<vec3> &positions)
+{
+	GLuint numvertices = (GLuint)positions.size();
+	GLfloat acmrbefore = acmr(indices, numvertices, FIFO_CACHE_SIZE);
+	GLfloat atvrbefore = atvr(indices, numvertices, FIFO_CACHE_SIZE);
+
+	vector<GLuint> input(indices);
+	optimiseVertexCache(indices, numvertices);
+	optimiseOverdraw(indices, positions, 1.05f);
+
+	ostringstream report;
+	report << "ACMR " << acmrbefore << " -> ";
+	GLfloat acmrafter = acmr(indices, numvertices, FIFO_CACHE_SIZE);
+	if (acmrafter > acmrbefore)
+	{
+		indices.swap(input);
+		report << acmrbefore << " (kept the input order, optimising gave " << acmrafter << ")";
+	}
+	else
+		report << acmrafter;
+	report << ", ATVR " << atvrbefore << " -> " << atvr(indices, numvertices, FIFO_CACHE_SIZE);
+	return report.str();
+}
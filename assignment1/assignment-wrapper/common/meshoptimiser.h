@@ -0,0 +1,39 @@
+/* meshoptimiser.h
+ Reorders the indices of a triangle list so the GPU reuses more transformed vertices
+ (Tom Forsyth's linear-speed vertex cache optimisation) and draws outer, likely occluding,
+ parts of the mesh first to reduce overdraw
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+
+class MeshOptimiser
+{
+public:
+	/* Reorder triangles for the post-transform vertex cache */
+	static void optimiseVertexCache(std::vector<GLuint> &indices, GLuint numvertices);
+
+	/* Reorder clusters of triangles from the vertex cache pass so outward facing clusters are drawn
+	   first. A cluster ends once its ACMR from a cold cache is within threshold of the whole mesh */
+	static void optimiseOverdraw(std::vector<GLuint> &indices, const std::vector<glm::vec3> &positions, GLfloat threshold);
+
+	/* Average cache miss ratio: transformed vertices per triangle for a FIFO cache of cachesize entries */
+	static GLfloat acmr(const std::vector<GLuint> &indices, GLuint numvertices, GLuint cachesize);
+
+	/* Average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is the best possible */
+	static GLfloat atvr(const std::vector<GLuint> &indices, GLuint numvertices, GLuint cachesize);
+
+	/* Run both passes and return the ACMR/ATVR before and after for the caller to print. If
+	   the result transforms more vertices than the input the input order is kept, meshes that
+	   are already close to the best order only lose to the overdraw pass's threshold.
+	   Nothing is shared between calls so meshes can be optimised on several threads at once */
+	static std::string optimise(std::vector<GLuint> &indices, const std::vector<glm::vec3> &positions);
+
+private:
+	static GLuint cacheMisses(const std::vector<GLuint> &indices, size_t first, size_t last, GLuint numvertices, GLuint cachesize);
+};
@@ -0,0 +1,651 @@
+/* meshsimplifier.cpp
+ Quadric error metric simplification by half edge collapses. Each vertex keeps a quadric for
+ the planes of the triangles merged into it and a quadric for the attributes (normal and colour)
+ of the vertices merged into it. Collapsing u into v costs both quadrics of u and v evaluated
+ at v, and the cheapest collapse that doesn't fold the surface over is always made next.
+ A vertex on a seam is collapsed together with the other vertices at its position, each into
+ its own neighbour at the position of v, and the collapse costs all of them
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshsimplifier.h"
+#include "parallel.h"
+#include "meshfile.h"
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+using namespace glm;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+/* Normal (3) and colour (4), scaled by the square roots of their weights */
+const int NUM_ATTRIBUTES = 7;
+
+/* Smallest cosine of the angle a triangle's normal may turn through in one collapse. Allowing
+   anything short of a flip lets thin triangles fold up to stand on edge across the surface */
+const GLfloat MIN_NORMAL_COSINE = 0.25f;
+
+/* Sum of squared distances to a set of planes, as a symmetric 4x4 matrix */
+struct Quadric
+{
+	double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+	double weight;		// Total area of the planes, to turn the sum back into a distance
+
+	void addPlane(dvec3 n, double d, double w)
+	{
+		a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+		a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+		a22 += w * n.z * n.z; a23 += w * n.z * d;
+		a33 += w * d * d;
+	}
+
+	void add(const Quadric &q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+		a11 += q.a11; a12 += q.a12; a13 += q.a13;
+		a22 += q.a22; a23 += q.a23; a33 += q.a33;
+		weight += q.weight;
+	}
+
+	double evaluate(const vec3 &p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+			+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+			+ a22 * z * z + 2 * a23 * z + a33;
+	}
+};
+
+/* Sum of weighted squared distances to the attributes of the vertices merged into a vertex:
+   weight * |x|^2 - 2 * sum . x + squares */
+struct AttributeQuadric
+{
+	double weight;
+	double sum[NUM_ATTRIBUTES];
+	double squares;
+
+	void add(const AttributeQuadric &q)
+	{
+		weight += q.weight;
+		for (int i = 0; i < NUM_ATTRIBUTES; i++)
+			sum[i] += q.sum[i];
+		squares += q.squares;
+	}
+
+	double evaluate(const GLfloat *x) const
+	{
+		double e = squares;
+		for (int i = 0; i < NUM_ATTRIBUTES; i++)
+			e += weight * x[i] * x[i] - 2 * sum[i] * x[i];
+		return std::max(e, 0.0);
+	}
+};
+
+/* Queue entry for the best collapse out of a vertex. Entries go stale when the vertex version changes */
+struct Candidate
+{
+	double cost;
+	GLuint vertex;
+	GLuint version;
+
+	bool operator<(const Candidate &other) const { return cost > other.cost; }	// Cheapest first
+};
+
+/* Working state for simplifying one mesh */
+class Simplifier
+{
+public:
+	Simplifier(SimplifyMesh &mesh, const SimplifySettings &settings) : mesh(mesh), settings(settings) {}
+
+	void run()
+	{
+		setup();
+
+		size_t target = settings.targettriangles;
+		GLfloat maxerror2 = settings.maxerror * settings.maxerror;
+		mesh.error = 0.f;
+
+		while (alivetriangles > target && !queue.empty())
+		{
+			Candidate top = queue.top();
+			queue.pop();
+			GLuint u = top.vertex;
+			if (removed[u] || version[u] != top.version)
+				continue;
+
+			/* The neighbourhood may have changed since this was queued, find the best valid collapse now */
+			double cost, distance2;
+			GLuint v = bestTarget(u, true, cost, distance2);
+			if (v == NONE)
+				continue;
+			if (cost > top.cost * 1.000001 + 1e-12)
+			{
+				queue.push(Candidate{ cost, u, version[u] });
+				continue;
+			}
+			if (distance2 > maxerror2)
+				continue;
+
+			/* collapse() finds the next candidates in the scratch arrays, so take a copy */
+			collapsing.assign(bestpairs.begin(), bestpairs.end());
+			for (size_t i = 0; i < collapsing.size(); i++)
+				collapse(collapsing[i].first, collapsing[i].second);
+			mesh.error = std::max(mesh.error, (GLfloat)sqrt(distance2));
+		}
+
+		compact();
+	}
+
+private:
+	static const GLuint NONE = 0xFFFFFFFF;
+
+	SimplifyMesh &mesh;
+	const SimplifySettings &settings;
+
+	vector<Quadric> quadrics;
+	vector<AttributeQuadric> attributequadrics;
+	vector<GLfloat> attributes;			// NUM_ATTRIBUTES per vertex
+	vector<vector<GLuint> > vertextriangles;
+	vector<char> alive, removed, boundary, locked;
+	vector<GLuint> seamgroup;				// Index into seamgroups, NONE for vertices not on a seam
+	vector<vector<GLuint> > seamgroups;		// The vertices at each position shared by more than one
+	vector<GLuint> version;
+	size_t alivetriangles;
+	priority_queue<Candidate> queue;
+	vector<pair<GLuint, GLuint> > collapsing;
+
+	/* Scratch arrays, kept between calls so the inner loop doesn't allocate */
+	mutable vector<GLuint> candidates, linku, linkv, common, twinlink;
+	vector<GLuint> around;
+	mutable vector<pair<double, GLuint> > costs;
+	mutable vector<pair<GLuint, GLuint> > pairs, bestpairs;
+
+	static unsigned long long edgeKey(GLuint a, GLuint b)
+	{
+		return (a < b) ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+	}
+
+	void setup()
+	{
+		size_t numvertices = mesh.positions.size();
+		size_t numtriangles = mesh.indices.size() / 3;
+
+		quadrics.assign(numvertices, Quadric());			// Value initialised, so all zero
+		attributequadrics.assign(numvertices, AttributeQuadric());
+		vertextriangles.assign(numvertices, vector<GLuint>());
+		alive.assign(numtriangles, 1);
+		removed.assign(numvertices, 0);
+		boundary.assign(numvertices, 0);
+		locked.assign(numvertices, 0);
+		for (size_t i = 0; i < mesh.locked.size(); i++)
+			locked[mesh.locked[i]] = 1;
+		seamgroup.assign(numvertices, NONE);
+		seamgroups.clear();
+		version.assign(numvertices, 0);
+		alivetriangles = numtriangles;
+
+		/* Scale the attributes so plain squared distances between them include the weights */
+		GLfloat normalscale = sqrt(settings.normalweight), colourscale = sqrt(settings.colourweight);
+		attributes.assign(numvertices * NUM_ATTRIBUTES, 0.f);
+		for (size_t v = 0; v < numvertices; v++)
+		{
+			GLfloat *a = &attributes[v * NUM_ATTRIBUTES];
+			if (v < mesh.normals.size())
+			{
+				a[0] = mesh.normals[v].x * normalscale; a[1] = mesh.normals[v].y * normalscale; a[2] = mesh.normals[v].z * normalscale;
+			}
+			if (v < mesh.colours.size())
+			{
+				for (int c = 0; c < 4; c++)
+					a[3 + c] = mesh.colours[v][c] * colourscale;
+			}
+		}
+
+		/* Vertices sharing a position with another vertex are on a seam. They are only moved
+		   together, see collapses(), so the sides of the seam can't pull apart */
+		struct PositionHash
+		{
+			size_t operator()(const vec3 &p) const
+			{
+				GLuint bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+			}
+		};
+		unordered_map<vec3, GLuint, PositionHash> positions;
+		positions.reserve(numvertices);
+		for (GLuint v = 0; v < numvertices; v++)
+		{
+			pair<unordered_map<vec3, GLuint, PositionHash>::iterator, bool> found = positions.insert(make_pair(mesh.positions[v], v));
+			if (found.second)
+				continue;
+
+			GLuint first = found.first->second;
+			if (seamgroup[first] == NONE)
+			{
+				seamgroup[first] = (GLuint)seamgroups.size();
+				seamgroups.push_back(vector<GLuint>(1, first));
+			}
+			seamgroup[v] = seamgroup[first];
+			seamgroups[seamgroup[v]].push_back(v);
+		}
+
+		/* Plane quadrics weighted by triangle area, and attribute quadrics sharing the area between the corners */
+		unordered_map<unsigned long long, GLuint> edgecount;
+		edgecount.reserve(numtriangles * 2);
+		for (GLuint t = 0; t < numtriangles; t++)
+		{
+			const GLuint *tri = &mesh.indices[t * 3];
+			dvec3 p0(mesh.positions[tri[0]]), p1(mesh.positions[tri[1]]), p2(mesh.positions[tri[2]]);
+			dvec3 n = cross(p1 - p0, p2 - p0);
+			double area = length(n) * 0.5;
+			if (area > 0.0)
+				n = normalize(n);
+
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint v = tri[k];
+				quadrics[v].addPlane(n, -dot(n, p0), area);
+				quadrics[v].weight += area;
+
+				const GLfloat *a = &attributes[v * NUM_ATTRIBUTES];
+				AttributeQuadric &aq = attributequadrics[v];
+				double w = area / 3.0;
+				aq.weight += w;
+				for (int i = 0; i < NUM_ATTRIBUTES; i++)
+				{
+					aq.sum[i] += w * a[i];
+					aq.squares += w * a[i] * a[i];
+				}
+
+				vertextriangles[v].push_back(t);
+				edgecount[edgeKey(tri[k], tri[(k + 1) % 3])]++;
+			}
+		}
+
+		/* Open boundary edges get a plane at right angles to their triangle, so moving a boundary
+		   vertex off the line of the boundary costs a lot */
+		for (GLuint t = 0; t < numtriangles; t++)
+		{
+			const GLuint *tri = &mesh.indices[t * 3];
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint a = tri[k], b = tri[(k + 1) % 3];
+				if (edgecount[edgeKey(a, b)] != 1)
+					continue;
+
+				boundary[a] = boundary[b] = 1;
+				dvec3 pa(mesh.positions[a]), pb(mesh.positions[b]), pc(mesh.positions[tri[(k + 2) % 3]]);
+				dvec3 edge = pb - pa;
+				dvec3 m = cross(edge, cross(edge, pc - pa));
+				if (length(m) == 0.0)
+					continue;
+				m = normalize(m);
+
+				double w = settings.boundaryweight * dot(edge, edge);
+				quadrics[a].addPlane(m, -dot(m, pa), w);
+				quadrics[b].addPlane(m, -dot(m, pa), w);
+			}
+		}
+
+		for (GLuint v = 0; v < numvertices; v++)
+			push(v);
+	}
+
+	/* Distinct vertices sharing an alive triangle with v */
+	void neighbours(GLuint v, vector<GLuint> &result) const
+	{
+		result.clear();
+		const vector<GLuint> &tris = vertextriangles[v];
+		for (size_t i = 0; i < tris.size(); i++)
+		{
+			if (!alive[tris[i]])
+				continue;
+			const GLuint *tri = &mesh.indices[tris[i] * 3];
+			for (int k = 0; k < 3; k++)
+				if (tri[k] != v)
+					result.push_back(tri[k]);
+		}
+		sort(result.begin(), result.end());
+		result.erase(unique(result.begin(), result.end()), result.end());
+	}
+
+	/* Number of alive triangles using both u and v */
+	GLuint sharedTriangles(GLuint u, GLuint v) const
+	{
+		GLuint count = 0;
+		const vector<GLuint> &tris = vertextriangles[u];
+		for (size_t i = 0; i < tris.size(); i++)
+		{
+			const GLuint *tri = &mesh.indices[tris[i] * 3];
+			if (alive[tris[i]] && (tri[0] == v || tri[1] == v || tri[2] == v))
+				count++;
+		}
+		return count;
+	}
+
+	/* Locked vertices never move and boundary vertices only slide along their boundary. A seam
+	   vertex also can't move when another vertex at its position is locked, see collapses() */
+	bool allowed(GLuint u, GLuint v) const
+	{
+		if (locked[u])
+			return false;
+		if (boundary[u])
+			return (boundary[v] || seamgroup[v] != NONE) && sharedTriangles(u, v) == 1;
+		return true;
+	}
+
+	/* The collapses that make up moving u into v, u into v first: for a vertex on a seam there is
+	   one for every vertex at its position, into a neighbour at the position of v. Returns false
+	   if any of them can't be made. With validate they are also checked with valid(), and must be
+	   far enough apart that making one doesn't change whether the others are valid */
+	bool collapses(GLuint u, GLuint v, bool validate, vector<pair<GLuint, GLuint> > &result) const
+	{
+		result.clear();
+		if (!allowed(u, v))
+			return false;
+		result.push_back(make_pair(u, v));
+
+		if (seamgroup[u] != NONE)
+		{
+			const vector<GLuint> &twins = seamgroups[seamgroup[u]];
+			for (size_t i = 0; i < twins.size(); i++)
+			{
+				GLuint twin = twins[i];
+				if (twin == u || removed[twin])
+					continue;
+
+				neighbours(twin, twinlink);
+				GLuint partner = NONE;
+				for (size_t j = 0; j < twinlink.size() && partner == NONE; j++)
+				{
+					if (mesh.positions[twinlink[j]] == mesh.positions[v] && allowed(twin, twinlink[j]))
+						partner = twinlink[j];
+				}
+				if (partner == NONE)
+					return false;
+				result.push_back(make_pair(twin, partner));
+			}
+		}
+
+		if (!validate)
+			return true;
+
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			if (!valid(result[i].first, result[i].second))
+				return false;
+			if (result.size() == 1)
+				break;
+
+			/* No other vertex that moves may be one of the edge or next to it */
+			for (int end = 0; end < 2; end++)
+			{
+				GLuint w = end ? result[i].second : result[i].first;
+				neighbours(w, twinlink);
+				for (size_t j = 0; j < result.size(); j++)
+				{
+					GLuint other = result[j].first;
+					if (j != i && (other == w || binary_search(twinlink.begin(), twinlink.end(), other)))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/* Cost of one collapse of u into v, and the distance it moves the surface, squared */
+	double collapseCost(GLuint u, GLuint v, double &distance2) const
+	{
+		Quadric q = quadrics[u];
+		q.add(quadrics[v]);
+		AttributeQuadric aq = attributequadrics[u];
+		aq.add(attributequadrics[v]);
+
+		double position = std::max(q.evaluate(mesh.positions[v]), 0.0);
+		distance2 = q.weight > 0.0 ? position / q.weight : 0.0;
+		return position + aq.evaluate(&attributes[v * NUM_ATTRIBUTES]);
+	}
+
+	/* Full check that collapsing u into v keeps the mesh manifold and doesn't flip any triangle
+	   or turn it far enough to stand on edge */
+	bool valid(GLuint u, GLuint v) const
+	{
+		/* Link condition: u and v may only share the neighbours on the triangles of the edge */
+		neighbours(u, linku);
+		neighbours(v, linkv);
+		common.clear();
+		set_intersection(linku.begin(), linku.end(), linkv.begin(), linkv.end(), back_inserter(common));
+		if (common.size() != sharedTriangles(u, v))
+			return false;
+
+		const vec3 &target = mesh.positions[v];
+		const vector<GLuint> &tris = vertextriangles[u];
+		for (size_t i = 0; i < tris.size(); i++)
+		{
+			if (!alive[tris[i]])
+				continue;
+			const GLuint *tri = &mesh.indices[tris[i] * 3];
+			if (tri[0] == v || tri[1] == v || tri[2] == v)
+				continue;
+
+			vec3 p[3], q[3];
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = mesh.positions[tri[k]];
+				q[k] = (tri[k] == u) ? target : p[k];
+			}
+			vec3 before = cross(p[1] - p[0], p[2] - p[0]);
+			vec3 after = cross(q[1] - q[0], q[2] - q[0]);
+			if (dot(before, after) <= MIN_NORMAL_COSINE * length(before) * length(after) ||
+				dot(after, after) <= 1e-12f * dot(before, before))
+				return false;
+		}
+		return true;
+	}
+
+	/* Cheapest collapse of u into one of its neighbours, NONE if there isn't one */
+	GLuint bestTarget(GLuint u, bool validate, double &bestcost, double &bestdistance2) const
+	{
+		neighbours(u, candidates);
+
+		costs.clear();
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			GLuint v = candidates[i];
+			if (!collapses(u, v, false, pairs))
+				continue;
+
+			double cost = 0.0, distance2;
+			for (size_t p = 0; p < pairs.size(); p++)
+				cost += collapseCost(pairs[p].first, pairs[p].second, distance2);
+			costs.push_back(make_pair(cost, v));
+		}
+		/* Only the cheapest matters unless it has to be checked, then try them in order */
+		if (validate)
+			sort(costs.begin(), costs.end());
+		else if (!costs.empty())
+			swap(costs[0], *min_element(costs.begin(), costs.end()));
+
+		for (size_t i = 0; i < costs.size(); i++)
+		{
+			GLuint v = costs[i].second;
+			if (!collapses(u, v, validate, bestpairs))
+				continue;
+
+			bestcost = costs[i].first;
+			bestdistance2 = 0.0;
+			for (size_t p = 0; p < bestpairs.size(); p++)
+			{
+				double distance2;
+				collapseCost(bestpairs[p].first, bestpairs[p].second, distance2);
+				bestdistance2 = std::max(bestdistance2, distance2);
+			}
+			return v;
+		}
+		return NONE;
+	}
+
+	void push(GLuint v)
+	{
+		double cost, distance2;
+		if (!removed[v] && bestTarget(v, false, cost, distance2) != NONE)
+			queue.push(Candidate{ cost, v, version[v] });
+	}
+
+	void collapse(GLuint u, GLuint v)
+	{
+		vector<GLuint> &tris = vertextriangles[u];
+		for (size_t i = 0; i < tris.size(); i++)
+		{
+			GLuint t = tris[i];
+			if (!alive[t])
+				continue;
+
+			GLuint *tri = &mesh.indices[t * 3];
+			if (tri[0] == v || tri[1] == v || tri[2] == v)
+			{
+				alive[t] = 0;
+				alivetriangles--;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+				if (tri[k] == u)
+					tri[k] = v;
+			vertextriangles[v].push_back(t);
+		}
+		vector<GLuint>().swap(tris);
+		removed[u] = 1;
+
+		quadrics[v].add(quadrics[u]);
+		attributequadrics[v].add(attributequadrics[u]);
+
+		/* Drop the dead triangles from v so its list doesn't keep growing */
+		vector<GLuint> &vtris = vertextriangles[v];
+		size_t kept = 0;
+		for (size_t i = 0; i < vtris.size(); i++)
+			if (alive[vtris[i]])
+				vtris[kept++] = vtris[i];
+		vtris.resize(kept);
+
+		/* Costs around v have all changed, and so have those of the vertices sharing a position
+		   with one of them, which collapse together with it. push() reuses the other scratch
+		   arrays so take a copy */
+		neighbours(v, linku);
+		around.assign(linku.begin(), linku.end());
+		around.push_back(v);
+		for (size_t i = 0, n = around.size(); i < n; i++)
+		{
+			if (seamgroup[around[i]] != NONE)
+			{
+				const vector<GLuint> &twins = seamgroups[seamgroup[around[i]]];
+				around.insert(around.end(), twins.begin(), twins.end());
+			}
+		}
+		for (size_t i = 0; i < around.size(); i++)
+		{
+			version[around[i]]++;
+			push(around[i]);
+		}
+	}
+
+	/* Keep the alive triangles and the vertices they use, in their original order */
+	void compact()
+	{
+		if (settings.keepvertices)
+		{
+			size_t kept = 0;
+			for (size_t t = 0; t < alive.size(); t++)
+			{
+				if (alive[t])
+					copy(mesh.indices.begin() + t * 3, mesh.indices.begin() + t * 3 + 3, mesh.indices.begin() + kept++ * 3);
+			}
+			mesh.indices.resize(kept * 3);
+			return;
+		}
+
+		vector<GLuint> remap(mesh.positions.size(), NONE);
+		vector<GLuint> indices;
+		indices.reserve(alivetriangles * 3);
+		for (size_t t = 0; t < alive.size(); t++)
+		{
+			if (alive[t])
+				indices.insert(indices.end(), mesh.indices.begin() + t * 3, mesh.indices.begin() + t * 3 + 3);
+		}
+		for (size_t i = 0; i < indices.size(); i++)
+			remap[indices[i]] = 0;
+
+		GLuint next = 0;
+		for (size_t v = 0; v < remap.size(); v++)
+		{
+			if (remap[v] == NONE)
+				continue;
+			remap[v] = next;
+			mesh.positions[next] = mesh.positions[v];
+			if (v < mesh.normals.size())
+				mesh.normals[next] = mesh.normals[v];
+			if (v < mesh.colours.size())
+				mesh.colours[next] = mesh.colours[v];
+			next++;
+		}
+		mesh.positions.resize(next);
+		if (!mesh.normals.empty())
+			mesh.normals.resize(next);
+		if (!mesh.colours.empty())
+			mesh.colours.resize(next);
+
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = remap[indices[i]];
+		mesh.indices.swap(indices);
+	}
+};
+
+const GLuint Simplifier::NONE;
+
+void MeshSimplifier::simplify(SimplifyMesh &mesh, const SimplifySettings &settings)
+{
+	mesh.error = 0.f;
+	if (mesh.indices.empty())
+		return;
+
+	Simplifier simplifier(mesh, settings);
+	simplifier.run();
+}
+
+void MeshSimplifier::simplify(vector<SimplifyMesh> &meshes, const SimplifySettings &settings)
+{
+	Parallel::forEach(meshes.size(), [&](size_t i) { simplify(meshes[i], settings); });
+}
+
+void MeshSimplifier::levelsOfDetail(const SimplifyMesh &mesh, GLuint numlevels, GLfloat ratio,
+	vector<vector<GLuint> > &levels, vector<GLfloat> &errors)
+{
+	levels.clear();
+	errors.clear();
+
+	/* The levels are independent so they are simplified in parallel */
+	size_t numtriangles = mesh.indices.size() / 3;
+	vector<SimplifyMesh> meshes(numlevels, mesh);
+	Parallel::forEach(numlevels, [&](size_t l)
+	{
+		SimplifySettings settings;
+		settings.targettriangles = (size_t)(numtriangles * pow(ratio, (GLfloat)(l + 1)));
+		settings.keepvertices = true;
+		simplify(meshes[l], settings);
+	});
+
+	size_t previous = numtriangles;
+	for (GLuint l = 0; l < numlevels; l++)
+	{
+		if (meshes[l].indices.size() / 3 >= previous)
+			continue;
+		previous = meshes[l].indices.size() / 3;
+		levels.push_back(vector<GLuint>());
+		levels.back().swap(meshes[l].indices);
+		errors.push_back(meshes[l].error);
+	}
+}
@@ -0,0 +1,57 @@
+/* meshsimplifier.h
+ Reduces the triangle count of an indexed triangle list by collapsing edges, cheapest first,
+ using quadric error metrics (Garland and Heckbert). The error includes how far normals and
+ colours move as well as positions, so levels of detail keep their shading.
+ Open boundaries and seams (vertices at the same position with different attributes) are kept:
+ a seam vertex only moves together with the other vertices at its position, so the two sides
+ can't crack apart
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+/* A mesh to simplify, changed in place. colours can be empty */
+struct SimplifyMesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> colours;
+	std::vector<GLuint> indices;
+	std::vector<GLuint> locked;	// Vertices that are never moved, e.g. ones given a colour of their own elsewhere
+	GLfloat error;		// Set by simplify: the largest distance error of any collapse made
+};
+
+struct SimplifySettings
+{
+	size_t targettriangles;		// Stop once there are this many triangles left
+	GLfloat maxerror;			// or before a collapse would move the surface further than this
+	GLfloat normalweight;		// Cost of normals moving, relative to positions
+	GLfloat colourweight;		// Cost of colours changing, relative to positions
+	GLfloat boundaryweight;		// Keeps open boundaries in place, relative to positions
+	bool keepvertices;			// Leave the vertices as they were and only replace the indices
+
+	SimplifySettings() : targettriangles(0), maxerror(1e30f), normalweight(0.1f), colourweight(0.1f), boundaryweight(10.f),
+		keepvertices(false) {}
+};
+
+class MeshSimplifier
+{
+public:
+	/* Simplify one mesh. Unused vertices are removed and the rest renumbered, unless settings
+	   keeps the vertices */
+	static void simplify(SimplifyMesh &mesh, const SimplifySettings &settings);
+
+	/* Simplify several meshes at once, one per worker thread */
+	static void simplify(std::vector<SimplifyMesh> &meshes, const SimplifySettings &settings);
+
+	/* Indices of numlevels coarser levels of detail of mesh, each with ratio times the triangles
+	   of the level before. Every level is simplified from the whole mesh, so its error is measured
+	   against it, and keeps the vertices so they are all drawn from the same vertex buffer.
+	   Levels that would be no smaller than the one before are left out */
+	static void levelsOfDetail(const SimplifyMesh &mesh, GLuint numlevels, GLfloat ratio,
+		std::vector<std::vector<GLuint> > &levels, std::vector<GLfloat> &errors);
+};
@@ -0,0 +1,96 @@
+/* packedvertex.cpp
+ Compressed vertex format for meshes that fit inside the unit cube
+ Andres Alvarez Olmo 2021
+*/
+
+#include "packedvertex.h"
+#include "meshfile.h"
+#include <glm/packing.hpp>
+#include "glm/gtc/packing.hpp"
+#include <cassert>
+
+using namespace std;
+using namespace glm;
+
+static const MeshFile::CodeStamp codestamp(__FILE__, __DATE__ " " __TIME__);
+
+/* Rounding to the nearest step is off by at most half a step (1/32767 and 1/511),
+   with a little extra for float rounding. For normals the worst case is the same half
+   step on all three components, plus 1% for renormalising a slightly short vector.
+   Both are checked over the whole input range by tests/packedvertex_test.cpp */
+const GLfloat VertexPacking::POSITION_ERROR = 0.5f / 32767.f + 1e-6f;
+const GLfloat VertexPacking::NORMAL_ERROR = sqrt(3.f) * 0.5f / 511.f * 1.01f;
+
+PackedVertex VertexPacking::pack(const vec3 &position, const vec3 &normal)
+{
+	PackedVertex v;
+	v.position_xy = packSnorm2x16(vec2(position.x, position.y));
+	v.position_zw = packSnorm2x16(vec2(position.z, 1.f));
+	v.normal = packSnorm3x10_1x2(vec4(normal, 0.f));
+	return v;
+}
+
+PrecisePackedVertex VertexPacking::packPrecise(const vec3 &position, const vec3 &normal)
+{
+	PrecisePackedVertex v;
+	v.position = position;
+	v.normal = packSnorm3x10_1x2(vec4(normal, 0.f));
+	return v;
+}
+
+uint32 VertexPacking::packColour(const vec4 &colour)
+{
+	return packUnorm4x8(colour);
+}
+
+void VertexPacking::pack(const vector<vec3> &positions, const vector<vec3> &normals, vector<PackedVertex> &packed)
+{
+	packed.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		// Packed positions only cover -1 to 1, meshes are generated at unit size and scaled by the model matrix
+		assert(all(lessThanEqual(abs(positions[i]), vec3(1.f))));
+
+		packed[i] = pack(positions[i], normals[i]);
+	}
+}
+
+void VertexPacking::setAttributes(GLuint attribute_v_coord, GLuint attribute_v_normal)
+{
+	glEnableVertexAttribArray(attribute_v_coord);
+	glVertexAttribPointer(attribute_v_coord, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid*)0);
+
+	glEnableVertexAttribArray(attribute_v_normal);
+	glVertexAttribPointer(attribute_v_normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (GLvoid*)(2 * sizeof(uint32)));
+}
+
+void VertexPacking::describe(GLuint attribute_v_coord, GLuint attribute_v_normal, MeshBinding &binding)
+{
+	VertexAttribute position = { attribute_v_coord, 4, GL_SHORT, GL_TRUE, 0 };
+	VertexAttribute normal = { attribute_v_normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 2 * sizeof(uint32) };
+	binding.stride = sizeof(PackedVertex);
+	binding.position = position;
+	binding.normal = normal;
+}
+
+void VertexPacking::describePrecise(GLuint attribute_v_coord, GLuint attribute_v_normal, MeshBinding &binding)
+{
+	/* The shaders' w of 1 is filled in for the missing fourth component */
+	VertexAttribute position = { attribute_v_coord, 3, GL_FLOAT, GL_FALSE, 0 };
+	VertexAttribute normal = { attribute_v_normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 3 * sizeof(GLfloat) };
+	binding.stride = sizeof(PrecisePackedVertex);
+	binding.position = position;
+	binding.normal = normal;
+}
+
+void VertexPacking::setColourAttribute(GLuint attribute_v_colours)
+{
+	glEnableVertexAttribArray(attribute_v_colours);
+	glVertexAttribPointer(attribute_v_colours, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (GLvoid*)0);
+}
+
+VertexAttribute VertexPacking::colourAttribute(GLuint attribute_v_colours)
+{
+	VertexAttribute colour = { attribute_v_colours, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0 };
+	return colour;
+}
@@ -0,0 +1,58 @@
+/* packedvertex.h
+ Compressed vertex format for meshes that fit inside the unit cube
+ Positions are four 16 bit signed normalised integers, normals are 10_10_10_2 signed normalised
+ integers and colours are RGBA8, all packed with the glm packing functions.
+ The GPU converts them back to floats when it fetches the attributes so the shaders are unchanged
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshdraw.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+/* 12 bytes per vertex instead of 24 bytes of float position and normal */
+struct PackedVertex
+{
+	glm::uint32 position_xy;
+	glm::uint32 position_zw;
+	glm::uint32 normal;
+};
+
+/* 16 bytes per vertex for meshes whose vertices are closer together than packed positions can
+   tell apart: a float position and the same packed normal */
+struct PrecisePackedVertex
+{
+	glm::vec3 position;
+	glm::uint32 normal;
+};
+
+class VertexPacking
+{
+public:
+	/* Largest difference between a packed and original position component */
+	static const GLfloat POSITION_ERROR;
+
+	/* Largest distance between a packed and original unit normal once it is renormalised */
+	static const GLfloat NORMAL_ERROR;
+
+	static PackedVertex pack(const glm::vec3 &position, const glm::vec3 &normal);
+	static PrecisePackedVertex packPrecise(const glm::vec3 &position, const glm::vec3 &normal);
+	static glm::uint32 packColour(const glm::vec4 &colour);
+
+	/* Pack a whole mesh. The positions must lie within -1 to 1 */
+	static void pack(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals, std::vector<PackedVertex> &packed);
+
+	/* Point the position and normal attributes at the currently bound buffer of PackedVertex */
+	static void setAttributes(GLuint attribute_v_coord, GLuint attribute_v_normal);
+
+	/* Point the colour attribute at the currently bound buffer of packed colours */
+	static void setColourAttribute(GLuint attribute_v_colours);
+
+	/* The same layouts as data, for a MeshDraw */
+	static void describe(GLuint attribute_v_coord, GLuint attribute_v_normal, MeshBinding &binding);
+	static void describePrecise(GLuint attribute_v_coord, GLuint attribute_v_normal, MeshBinding &binding);
+	static VertexAttribute colourAttribute(GLuint attribute_v_colours);
+};
@@ -0,0 +1,122 @@
+/* parallel.cpp
+ Runs independent pieces of work on a pool of worker threads
+ Andres Alvarez Olmo 2021
+*/
+
+#include "parallel.h"
+#include "allocationcounter.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/* Set on the pool's threads, and on a thread while it runs a forEach, so nested calls
+   don't wait on workers that are busy with the outer call */
+static thread_local bool inpool = false;
+
+class WorkerPool
+{
+public:
+	WorkerPool() : body(NULL), count(0), generation(0), busy(0), stopping(false)
+	{
+		size_t numthreads = max(thread::hardware_concurrency(), 1u);
+		for (size_t t = 1; t < numthreads; t++)
+			threads.push_back(thread([this]() { run(); }));
+	}
+
+	~WorkerPool()
+	{
+		{
+			lock_guard<mutex> lock(guard);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+	}
+
+	void forEach(size_t newcount, const function<void(size_t)> &newbody)
+	{
+		lock_guard<mutex> caller(calls);		// One job at a time from any number of threads
+		{
+			lock_guard<mutex> lock(guard);
+			body = &newbody;
+			count = newcount;
+			next = 0;
+			busy = threads.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		work();		// This thread works too rather than waiting idle
+
+		unique_lock<mutex> lock(guard);
+		done.wait(lock, [this]() { return busy == 0; });
+		body = NULL;
+	}
+
+private:
+	/* Each thread takes the next item until they have all been claimed */
+	void work()
+	{
+		for (size_t i = next++; i < count; i = next++)
+			(*body)(i);
+	}
+
+	void run()
+	{
+		inpool = true;
+		AllocationCounter::track();		// Their allocations are the frame's too
+
+		size_t seen = 0;
+		for (;;)
+		{
+			{
+				unique_lock<mutex> lock(guard);
+				wake.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+
+			work();
+
+			lock_guard<mutex> lock(guard);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+
+	vector<thread> threads;
+	mutex calls, guard;
+	condition_variable wake, done;
+
+	const function<void(size_t)> *body;
+	size_t count;
+	atomic<size_t> next;
+	size_t generation;
+	size_t busy;			// Workers still on the current job
+	bool stopping;
+};
+
+void Parallel::forEach(size_t count, const function<void(size_t)> &body)
+{
+	if (count == 0)
+		return;
+
+	if (count == 1 || inpool)
+	{
+		for (size_t i = 0; i < count; i++)
+			body(i);
+		return;
+	}
+
+	static WorkerPool pool;
+	inpool = true;
+	pool.forEach(count, body);
+	inpool = false;
+}
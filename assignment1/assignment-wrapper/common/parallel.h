@@ -0,0 +1,20 @@
+/* parallel.h
+ Runs independent pieces of work, such as generating or simplifying separate meshes,
+ on a pool of worker threads. The threads are started on first use and kept until the
+ program exits, so per frame work does not pay for creating them (or allocate) every call
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+class Parallel
+{
+public:
+	/* Call body(i) for every i from 0 to count - 1, spread over one thread per core.
+	   The calling thread works too and the call returns when every item is done.
+	   A call made from inside body runs on the calling thread alone */
+	static void forEach(size_t count, const std::function<void(size_t)> &body);
+};
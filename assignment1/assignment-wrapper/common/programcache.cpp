@@ -0,0 +1,199 @@
+/* programcache.cpp
+ On-disk cache of linked shader program binaries
+ Andres Alvarez Olmo 2021
+*/
+
+#include "programcache.h"
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+const GLuint ProgramCache::FORMAT_VERSION = 1;
+string ProgramCache::directory = "shadercache";
+
+/* Fixed size header at the start of each file, followed by the driver string and the binary */
+struct ProgramFileHeader
+{
+	char magic[4];			// "PROG"
+	uint32_t formatversion;
+	uint32_t binaryformat;	// Driver specific format returned by glGetProgramBinary
+	uint32_t binarylength;
+	uint32_t driverlength;	// The driver string is stored too, so a clash of hashes is not mistaken for a hit
+	uint32_t reserved;
+	uint64_t hash;
+};
+
+/* Binaries need ARB_get_program_binary (core in 4.1) and at least one format from the driver,
+   some drivers expose the functions but no formats */
+bool ProgramCache::supported()
+{
+	if (directory.empty() || !glext_ARB_get_program_binary)
+		return false;
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+/* Binaries are only valid for the driver that made them */
+string ProgramCache::driver()
+{
+	const char *vendor = (const char*)glGetString(GL_VENDOR);
+	const char *renderer = (const char*)glGetString(GL_RENDERER);
+	const char *version = (const char*)glGetString(GL_VERSION);
+	return string(vendor ? vendor : "") + "\n" + (renderer ? renderer : "") + "\n" + (version ? version : "");
+}
+
+/* 64 bit FNV-1a hash of the sources and the driver. Each string is followed by a zero byte so
+   moving text from the end of one source to the start of the next changes the hash */
+unsigned long long ProgramCache::hash(const vector<string> &sources, const string &driver)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t s = 0; s <= sources.size(); s++)
+	{
+		const string &text = (s < sources.size()) ? sources[s] : driver;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			hash ^= (unsigned char)text[i];
+			hash *= 1099511628211ULL;
+		}
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+string ProgramCache::path(unsigned long long hash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.prog", hash);
+	return directory + "/" + name;
+}
+
+GLuint ProgramCache::load(const vector<string> &sources)
+{
+	if (!supported())
+		return 0;
+
+	string identity = driver();
+	uint64_t key = hash(sources, identity);
+	string filename = path(key);
+
+	ifstream in(filename.c_str(), ios::binary);
+	if (!in)
+		return 0;
+
+	ProgramFileHeader header;
+	if (!in.read((char*)&header, sizeof(header)))
+		return 0;
+
+	bool valid = memcmp(header.magic, "PROG", 4) == 0
+		&& header.formatversion == FORMAT_VERSION
+		&& header.hash == key
+		&& header.driverlength == identity.size()
+		&& header.binarylength > 0;
+	if (!valid)
+		return 0;
+
+	string storeddriver(header.driverlength, '\0');
+	vector<char> binary(header.binarylength);
+	if (!in.read(&storeddriver[0], storeddriver.size()) || storeddriver != identity
+		|| !in.read(&binary[0], binary.size()))
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binaryformat, &binary[0], (GLsizei)binary.size());
+
+	/* The driver can reject a binary it made itself, e.g. after a setting changed.
+	   Drop the file so it is replaced by the next successful build */
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		glDeleteProgram(program);
+		in.close();
+		remove(filename.c_str());
+		return 0;
+	}
+
+	return program;
+}
+
+void ProgramCache::retrievable(GLuint program)
+{
+	if (supported())
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramCache::save(const vector<string> &sources, GLuint program)
+{
+	if (!supported())
+		return false;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	vector<char> binary(length);
+	GLenum binaryformat = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &binaryformat, &binary[0]);
+	if (written <= 0)
+		return false;
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+
+	string identity = driver();
+	ProgramFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PROG", 4);
+	header.formatversion = FORMAT_VERSION;
+	header.binaryformat = binaryformat;
+	header.binarylength = (uint32_t)written;
+	header.driverlength = (uint32_t)identity.size();
+	header.hash = hash(sources, identity);
+
+	/* Write to a temporary file and rename it so a reader never loads a half written file */
+	string filename = path(header.hash);
+	string temporary = filename + ".tmp";
+	{
+		ofstream out(temporary.c_str(), ios::binary | ios::trunc);
+		if (!out)
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write(identity.data(), identity.size());
+		out.write(&binary[0], written);
+		if (!out)
+		{
+			out.close();
+			remove(temporary.c_str());
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	bool renamed = MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool renamed = rename(temporary.c_str(), filename.c_str()) == 0;
+#endif
+	if (!renamed)
+		remove(temporary.c_str());
+	return renamed;
+}
@@ -0,0 +1,39 @@
+/* programcache.h
+ On-disk cache of linked shader programs using glGetProgramBinary / glProgramBinary.
+ Each program is stored under a hash of its shader sources and of the driver (vendor, renderer
+ and version), so editing a shader or updating the driver just misses the cache.
+ Drivers are free to reject a binary at any time, callers then compile from source as before
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <string>
+#include <vector>
+
+class ProgramCache
+{
+public:
+	/* Bump when the file layout changes */
+	static const GLuint FORMAT_VERSION;
+
+	/* Directory holding the cache files. An empty string turns the cache off */
+	static std::string directory;
+
+	/* Create a program from the cached binary for these sources. Returns 0 if there is no
+	   cache file or the driver will not take the binary, and the program has to be built */
+	static GLuint load(const std::vector<std::string> &sources);
+
+	/* Call before linking a program that will be saved, so the driver keeps its binary */
+	static void retrievable(GLuint program);
+
+	/* Store the binary of a linked program. Failing only means it is compiled again next time */
+	static bool save(const std::vector<std::string> &sources, GLuint program);
+
+private:
+	static bool supported();
+	static std::string driver();
+	static unsigned long long hash(const std::vector<std::string> &sources, const std::string &driver);
+	static std::string path(unsigned long long hash);
+};
@@ -0,0 +1,60 @@
+/* samplecounter.cpp
+ Non-blocking GL_SAMPLES_PASSED counts
+ Andres Alvarez Olmo 2021
+*/
+
+#include "samplecounter.h"
+
+SampleCounter::SampleCounter() : next(0), pending(0), counting(false)
+{
+	for (GLuint q = 0; q < QUERIES; q++)
+		queries[q] = 0;
+}
+
+SampleCounter::~SampleCounter()
+{
+}
+
+void SampleCounter::create()
+{
+	glGenQueries(QUERIES, queries);
+}
+
+void SampleCounter::begin()
+{
+	counting = pending < QUERIES;
+	if (counting)
+		glBeginQuery(GL_SAMPLES_PASSED, queries[next]);
+}
+
+void SampleCounter::end()
+{
+	if (!counting)
+		return;
+	glEndQuery(GL_SAMPLES_PASSED);
+	next = (next + 1) % QUERIES;
+	pending++;
+	counting = false;
+}
+
+/* Queries finish in order, so stop at the first one that isn't ready */
+GLuint64 SampleCounter::collect(GLuint &counts)
+{
+	GLuint64 total = 0;
+	counts = 0;
+	while (pending > 0)
+	{
+		GLuint query = queries[(next + QUERIES - pending) % QUERIES];
+		GLuint available = 0;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint64 samples = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &samples);
+		total += samples;
+		counts++;
+		pending--;
+	}
+	return total;
+}
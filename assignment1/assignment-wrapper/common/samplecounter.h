@@ -0,0 +1,36 @@
+/* samplecounter.h
+ Counts the samples that pass the depth test between begin() and end() with GL_SAMPLES_PASSED
+ queries, e.g. to measure overdraw. The GPU answers a frame or two later, so the queries are
+ kept in a ring and read back only once they are ready, never waiting for the result
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+
+class SampleCounter
+{
+public:
+	SampleCounter();
+	~SampleCounter();
+
+	/* Create the queries */
+	void create();
+
+	/* Count the samples drawn between these. If every query is still waiting for the GPU
+	   this count is skipped */
+	void begin();
+	void end();
+
+	/* Sum of the counts that have come back since the last call and how many there were */
+	GLuint64 collect(GLuint &counts);
+
+private:
+	static const GLuint QUERIES = 4;
+
+	GLuint queries[QUERIES];
+	GLuint next;		// Query for the next begin()
+	GLuint pending;		// Queries ended but not read back, the oldest is next - pending
+	bool counting;
+};
@@ -0,0 +1,167 @@
+/* shaderloader.cpp
+ Shader source loading with #include expansion and variant #defines
+ Andres Alvarez Olmo 2021
+*/
+
+#include "shaderloader.h"
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+map<string, ShaderLoader::File> ShaderLoader::files;
+
+bool ShaderLoader::readFile(const string &path, string &text)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	text.resize(size > 0 ? (size_t)size : 0);
+	size_t read = text.empty() ? 0 : fread(&text[0], 1, text.size(), file);
+	fclose(file);
+	return read == text.size();
+}
+
+/* Includes are relative to the directory of the file that includes them */
+static string resolve(const string &from, const string &name)
+{
+	size_t slash = from.find_last_of("/\\");
+	return (slash == string::npos) ? name : from.substr(0, slash + 1) + name;
+}
+
+const ShaderLoader::File* ShaderLoader::parse(const string &path)
+{
+	map<string, File>::iterator found = files.find(path);
+	if (found != files.end())
+		return &found->second;
+
+	string text;
+	if (!readFile(path, text))
+	{
+		cerr << "Could not read shader file " << path << endl;
+		return NULL;
+	}
+
+	/* Split the text at each #include line. Only the include lines are looked at closely,
+	   everything else is copied through in large pieces */
+	File &file = files[path];
+	Piece piece;
+	size_t start = 0, pieceStart = 0;
+	int line = 1;
+	while (start < text.size())
+	{
+		size_t end = text.find('\n', start);
+		end = (end == string::npos) ? text.size() : end + 1;
+
+		size_t first = text.find_first_not_of(" \t", start);
+		if (first < end && text.compare(first, 8, "#include") == 0)
+		{
+			size_t open = text.find_first_of("\"<", first + 8);
+			size_t close = (open < end) ? text.find_first_of("\">", open + 1) : string::npos;
+			if (close < end)
+			{
+				piece.text.assign(text, pieceStart, start - pieceStart);
+				piece.include = resolve(path, text.substr(open + 1, close - open - 1));
+				piece.nextline = line + 1;
+				file.pieces.push_back(piece);
+				pieceStart = end;
+			}
+		}
+
+		start = end;
+		line++;
+	}
+
+	piece.text.assign(text, pieceStart, string::npos);
+	piece.include.clear();
+	piece.nextline = line;
+	file.pieces.push_back(piece);
+	return &file;
+}
+
+bool ShaderLoader::expand(const string &path, ShaderSource &source)
+{
+	const File *file = parse(path);
+	if (!file)
+		return false;
+
+	size_t number = source.files.size();
+	source.files.push_back(path);
+
+	for (size_t p = 0; p < file->pieces.size(); p++)
+	{
+		const Piece &piece = file->pieces[p];
+		source.text += piece.text;
+		if (piece.include.empty())
+			continue;
+
+		// Already included (or including itself), so leave it out like #pragma once
+		if (find(source.files.begin(), source.files.end(), piece.include) != source.files.end())
+			continue;
+
+		if (!piece.text.empty() && piece.text[piece.text.size() - 1] != '\n')
+			source.text += '\n';
+		source.text += "#line 1 " + to_string(source.files.size()) + "\n";
+		if (!expand(piece.include, source))
+		{
+			cerr << "\tincluded from " << path << " line " << piece.nextline - 1 << endl;
+			return false;
+		}
+		if (source.text[source.text.size() - 1] != '\n')
+			source.text += '\n';
+		source.text += "#line " + to_string(piece.nextline) + " " + to_string(number) + "\n";
+	}
+	return true;
+}
+
+bool ShaderLoader::load(const string &path, const vector<string> &defines, ShaderSource &source)
+{
+	source.text.clear();
+	source.files.clear();
+	source.hash = 0;
+	if (!expand(path, source))
+		return false;
+
+	/* Defines go after #version, which has to come first, followed by a #line so the line
+	   numbers of the rest of the file are unchanged */
+	if (!defines.empty())
+	{
+		string block;
+		for (size_t d = 0; d < defines.size(); d++)
+			block += "#define " + defines[d] + "\n";
+
+		size_t version = source.text.find("#version");
+		size_t insert = 0;
+		if (version != string::npos)
+		{
+			insert = source.text.find('\n', version);
+			insert = (insert == string::npos) ? source.text.size() : insert + 1;
+			block = (insert == source.text.size() && source.text[insert - 1] != '\n') ? "\n" + block : block;
+		}
+		int nextline = 1 + (int)count(source.text.begin(), source.text.begin() + insert, '\n');
+		block += "#line " + to_string(nextline) + " 0\n";
+		source.text.insert(insert, block);
+	}
+
+	/* 64 bit FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < source.text.size(); i++)
+	{
+		hash ^= (unsigned char)source.text[i];
+		hash *= 1099511628211ULL;
+	}
+	source.hash = hash;
+	return true;
+}
+
+void ShaderLoader::forget(const string &path)
+{
+	files.erase(path);
+}
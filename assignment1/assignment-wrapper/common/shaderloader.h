@@ -0,0 +1,57 @@
+/* shaderloader.h
+ Loads shader source files, expands #include "file" directives and adds #defines for variants.
+ Each file is read once with a single read and split into text and includes, which are kept
+ so later loads (other variants, other programs sharing a library) don't touch the disk.
+ Each file is included at most once per program, so shared libraries can be included from
+ several places. #line directives around included text keep compile errors pointing at the
+ right file: the source number in an error is the index into ShaderSource::files
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* Preprocessed source ready to compile, with a hash of the text so callers can tell quickly
+   whether anything changed */
+struct ShaderSource
+{
+	std::string text;
+	unsigned long long hash;
+	std::vector<std::string> files;		// Every file the text came from, the top level one first
+};
+
+class ShaderLoader
+{
+public:
+	/* Load path and everything it includes. Each define is "NAME" or "NAME value" and is added
+	   straight after the #version line. Returns false and prints the reason if a file is missing */
+	static bool load(const std::string &path, const std::vector<std::string> &defines, ShaderSource &source);
+
+	/* Drop a file from the cache so the next load reads it from disk again */
+	static void forget(const std::string &path);
+
+	/* Read a whole file in one go */
+	static bool readFile(const std::string &path, std::string &text);
+
+private:
+	/* A run of lines from a file, then optionally an #include to expand after it */
+	struct Piece
+	{
+		std::string text;
+		std::string include;	// Resolved path of the included file, empty for the last piece
+		int nextline;			// Line the text continues on after the include
+	};
+
+	struct File
+	{
+		std::vector<Piece> pieces;
+	};
+
+	static const File* parse(const std::string &path);
+	static bool expand(const std::string &path, ShaderSource &source);
+
+	static std::map<std::string, File> files;
+};
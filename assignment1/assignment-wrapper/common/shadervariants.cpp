@@ -0,0 +1,92 @@
+/* shadervariants.cpp
+ Cache of specialised shader programs
+ Andres Alvarez Olmo 2021
+*/
+
+#include "shadervariants.h"
+#include "shaderloader.h"
+
+using namespace std;
+
+ShaderVariants::ShaderVariants(const string &vertexpath, const string &fragmentpath)
+	: vertexpath(vertexpath), fragmentpath(fragmentpath)
+{
+}
+
+/* Like the mesh buffers, the programs live until the context is destroyed */
+ShaderVariants::~ShaderVariants()
+{
+}
+
+size_t ShaderVariants::variant(const vector<string> &defines)
+{
+	map<vector<string>, size_t>::iterator found = lookup.find(defines);
+	if (found != lookup.end())
+		return found->second;
+
+	size_t index = variants.size();
+	variants.emplace_back();
+	Variant &added = variants.back();
+	added.defines = defines;
+	added.program = 0;
+	added.vertexhash = added.fragmenthash = 0;
+	lookup[defines] = index;
+
+	load(added);
+	return index;
+}
+
+GLuint ShaderVariants::program(size_t variant, GLuint fallback) const
+{
+	GLuint built = variants[variant].program;
+	return built ? built : fallback;
+}
+
+/* Load the sources and start a build unless they are the same as the latest build.
+   If they can't be loaded the variant keeps the program it has */
+void ShaderVariants::load(Variant &variant)
+{
+	ShaderSource vertexsource, fragmentsource;
+	if (!ShaderLoader::load(vertexpath, variant.defines, vertexsource)
+		|| !ShaderLoader::load(fragmentpath, variant.defines, fragmentsource))
+		return;
+
+	sourcefiles.insert(vertexsource.files.begin(), vertexsource.files.end());
+	sourcefiles.insert(fragmentsource.files.begin(), fragmentsource.files.end());
+
+	if (vertexsource.hash == variant.vertexhash && fragmentsource.hash == variant.fragmenthash)
+		return;
+	variant.vertexhash = vertexsource.hash;
+	variant.fragmenthash = fragmentsource.hash;
+
+	variant.build.compile(vertexsource.text, fragmentsource.text);
+}
+
+bool ShaderVariants::poll()
+{
+	bool changed = false;
+	for (size_t v = 0; v < variants.size(); v++)
+	{
+		Variant &variant = variants[v];
+		if (!variant.build.poll() || !variant.build.ready())
+			continue;
+
+		// Swap in the new build. Failed builds never get here so the old program stays
+		if (variant.program)
+			glDeleteProgram(variant.program);
+		variant.program = variant.build.detach();
+		changed = true;
+	}
+	return changed;
+}
+
+void ShaderVariants::reload()
+{
+	for (size_t v = 0; v < variants.size(); v++)
+		load(variants[v]);
+}
+
+vector<string> ShaderVariants::files() const
+{
+	return vector<string>(sourcefiles.begin(), sourcefiles.end());
+}
@@ -0,0 +1,64 @@
+/* shadervariants.h
+ Specialised programs built from one pair of shader files with different #defines, e.g. one
+ per colour mode, instead of a single program branching on uniforms for every fragment.
+ Variants are built in the background with AsyncProgram and kept for the life of the object.
+ Until a variant is ready (and while an edited one is rebuilt) the caller's fallback or the
+ previous build is used
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "asyncprogram.h"
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class ShaderVariants
+{
+public:
+	ShaderVariants(const std::string &vertexpath, const std::string &fragmentpath);
+	~ShaderVariants();
+
+	/* Index of the variant with these defines ("NAME" or "NAME value"), which starts building
+	   the first time it is asked for. Look indices up once, not every frame */
+	size_t variant(const std::vector<std::string> &defines);
+
+	/* Program to draw a variant with, or fallback until it has been built */
+	GLuint program(size_t variant, GLuint fallback) const;
+
+	/* Advance the builds without blocking. Returns true if any variant's program changed,
+	   so the caller knows to look up uniforms again */
+	bool poll();
+
+	/* Load every variant from source again, e.g. after an edit. Variants whose text did not
+	   change are not rebuilt */
+	void reload();
+
+	/* Every file the variants were loaded from, for the shader watcher */
+	std::vector<std::string> files() const;
+
+private:
+	ShaderVariants(const ShaderVariants&) = delete;
+	ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+	struct Variant
+	{
+		std::vector<std::string> defines;
+		GLuint program;					// Last successful build, 0 until there is one
+		AsyncProgram build;				// Build of the latest text in progress
+		unsigned long long vertexhash;	// Hashes of the latest text, built or being built
+		unsigned long long fragmenthash;
+	};
+
+	void load(Variant &variant);
+
+	std::string vertexpath;
+	std::string fragmentpath;
+	std::deque<Variant> variants;	// A deque so adding variants never moves the AsyncPrograms
+	std::map<std::vector<std::string>, size_t> lookup;
+	std::set<std::string> sourcefiles;
+};
@@ -0,0 +1,240 @@
+/* shaderwatcher.cpp
+ Background watcher for shader file edits
+ Andres Alvarez Olmo 2021
+*/
+
+#include "shaderwatcher.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/* How often the thread checks whether it should stop, in milliseconds */
+const int STOP_CHECK_INTERVAL = 100;
+
+/* Directory part of a path including the trailing slash, so prefix + name gives the path back */
+static string directoryPrefix(const string &path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return (slash == string::npos) ? string() : path.substr(0, slash + 1);
+}
+
+#ifdef _WIN32
+/* Write time in 100 ns units (kept that finely on NTFS, 2 s on FAT) and size, both 0 if the
+   file can't be read, e.g. while an editor is replacing it */
+ShaderWatcher::FileStamp ShaderWatcher::fileStamp(const string &path)
+{
+	FileStamp stamp = { 0, 0 };
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+	{
+		stamp.written = ((long long)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+		stamp.size = ((long long)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	}
+	return stamp;
+}
+#endif
+
+ShaderWatcher::ShaderWatcher() : running(false)
+{
+#ifndef _WIN32
+	inotify = -1;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	stop();
+}
+
+void ShaderWatcher::watch(const vector<string> &newfiles)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		for (size_t f = 0; f < newfiles.size(); f++)
+		{
+			if (!files.insert(newfiles[f]).second)
+				continue;
+#ifdef _WIN32
+			lastwrite[newfiles[f]] = fileStamp(newfiles[f]);
+#endif
+			addDirectory(directoryPrefix(newfiles[f]));
+		}
+	}
+
+	if (!running)
+	{
+		running = true;
+		worker = thread(&ShaderWatcher::run, this);
+	}
+}
+
+vector<string> ShaderWatcher::changed()
+{
+	lock_guard<mutex> guard(lock);
+	vector<string> result(pending.begin(), pending.end());
+	pending.clear();
+	return result;
+}
+
+void ShaderWatcher::stop()
+{
+	running = false;
+	if (worker.joinable())
+		worker.join();
+
+#ifndef _WIN32
+	if (inotify >= 0)
+		close(inotify);
+	inotify = -1;
+#endif
+	directories.clear();
+}
+
+/* Called with the lock held. Whole directories are watched because editors often save by
+   writing a new file and renaming it over the old one, which a watch on the file would miss */
+void ShaderWatcher::addDirectory(const string &prefix)
+{
+	if (directories.count(prefix))
+		return;
+
+#ifdef _WIN32
+	// The thread opens the notification handles itself
+	directories[prefix] = 0;
+#else
+	if (inotify < 0)
+		inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify < 0)
+	{
+		cerr << "ShaderWatcher: cannot start inotify, edited shaders won't be reloaded" << endl;
+		return;
+	}
+
+	string directory = prefix.empty() ? "." : prefix;
+	int descriptor = inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (descriptor < 0)
+		cerr << "ShaderWatcher: cannot watch " << directory << endl;
+	else
+		directories[prefix] = descriptor;
+#endif
+}
+
+#ifdef _WIN32
+
+/* A notification only says something in the directory changed, so compare the write times
+   and sizes of the watched files to find which */
+void ShaderWatcher::run()
+{
+	map<string, HANDLE> handles;
+	while (running)
+	{
+		vector<HANDLE> waiting;
+		vector<string> prefixes;
+		{
+			lock_guard<mutex> guard(lock);
+			for (map<string, int>::iterator d = directories.begin(); d != directories.end(); ++d)
+			{
+				if (!handles.count(d->first))
+				{
+					string directory = d->first.empty() ? "." : d->first;
+					handles[d->first] = FindFirstChangeNotificationA(directory.c_str(), FALSE,
+						FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+				}
+				if (handles[d->first] != INVALID_HANDLE_VALUE)
+				{
+					waiting.push_back(handles[d->first]);
+					prefixes.push_back(d->first);
+				}
+			}
+		}
+
+		if (waiting.empty())
+		{
+			Sleep(STOP_CHECK_INTERVAL);
+			continue;
+		}
+
+		DWORD result = WaitForMultipleObjects((DWORD)waiting.size(), &waiting[0], FALSE, STOP_CHECK_INTERVAL);
+		if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + waiting.size())
+			continue;
+
+		size_t signalled = result - WAIT_OBJECT_0;
+		FindNextChangeNotification(waiting[signalled]);
+
+		lock_guard<mutex> guard(lock);
+		for (set<string>::iterator f = files.begin(); f != files.end(); ++f)
+		{
+			if (directoryPrefix(*f) != prefixes[signalled])
+				continue;
+
+			FileStamp stamp = fileStamp(*f);
+			if (stamp != lastwrite[*f])
+			{
+				lastwrite[*f] = stamp;
+				pending.insert(*f);
+			}
+		}
+	}
+
+	for (map<string, HANDLE>::iterator h = handles.begin(); h != handles.end(); ++h)
+		if (h->second != INVALID_HANDLE_VALUE)
+			FindCloseChangeNotification(h->second);
+}
+
+#else
+
+void ShaderWatcher::run()
+{
+	/* Big enough for many events, aligned for struct inotify_event */
+	alignas(struct inotify_event) char buffer[4096];
+
+	while (running)
+	{
+		int descriptor;
+		{
+			lock_guard<mutex> guard(lock);
+			descriptor = inotify;
+		}
+		if (descriptor < 0)
+			return;
+
+		struct pollfd waiting = { descriptor, POLLIN, 0 };
+		if (poll(&waiting, 1, STOP_CHECK_INTERVAL) <= 0)
+			continue;
+
+		ssize_t length;
+		while ((length = read(descriptor, buffer, sizeof(buffer))) > 0)
+		{
+			lock_guard<mutex> guard(lock);
+			for (char *next = buffer; next < buffer + length; )
+			{
+				struct inotify_event *event = (struct inotify_event*)next;
+				next += sizeof(struct inotify_event) + event->len;
+				if (event->len == 0)
+					continue;
+
+				// Match the event back to a watched file through its directory
+				for (map<string, int>::iterator d = directories.begin(); d != directories.end(); ++d)
+				{
+					if (d->second != event->wd)
+						continue;
+
+					string path = d->first + event->name;
+					if (files.count(path))
+						pending.insert(path);
+				}
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,63 @@
+/* shaderwatcher.h
+ Watches shader files for edits on a background thread (inotify on Linux, directory change
+ notifications on Windows) so shaders can be rebuilt while the program runs. The frame loop
+ asks for the changed files with changed(), which never waits on the thread
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ShaderWatcher
+{
+public:
+	ShaderWatcher();
+	~ShaderWatcher();
+
+	/* Add files to watch, e.g. ShaderSource::files. Starts the thread the first time */
+	void watch(const std::vector<std::string> &files);
+
+	/* Files written since the last call, each listed once however many times it was saved */
+	std::vector<std::string> changed();
+
+	void stop();
+
+private:
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	void run();
+	void addDirectory(const std::string &prefix);
+
+	std::thread worker;
+	std::atomic<bool> running;
+
+	std::mutex lock;					// Guards everything below
+	std::set<std::string> files;
+	std::set<std::string> pending;
+	std::map<std::string, int> directories;	// Directory prefix of the watched files ("" or ending in a slash) to its watch
+
+#ifdef _WIN32
+	/* What a file looked like when last checked. The write time alone can miss a save made
+	   soon after the last one on file systems with coarse times, the size catches most of those */
+	struct FileStamp
+	{
+		long long written;
+		long long size;
+
+		bool operator!=(const FileStamp &other) const { return written != other.written || size != other.size; }
+	};
+	static FileStamp fileStamp(const std::string &path);
+
+	std::map<std::string, FileStamp> lastwrite;
+#else
+	int inotify;
+#endif
+};
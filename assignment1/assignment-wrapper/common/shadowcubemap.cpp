@@ -0,0 +1,180 @@
+/* shadowcubemap.cpp
+ Cached omnidirectional shadow map for the main light
+ Andres Alvarez Olmo 2021
+*/
+
+#include "shadowcubemap.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+/* Where each face looks and which way is up, in the order of the GL_TEXTURE_CUBE_MAP_POSITIVE_X
+   faces. The cube map convention has y pointing down the side faces */
+static const vec3 FACE_DIRECTIONS[6] = {
+	vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+};
+static const vec3 FACE_UPS[6] = {
+	vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0)
+};
+
+/* Add bytes to a 64 bit FNV-1a hash */
+static void hashBytes(uint64_t &hash, const void *data, size_t bytes)
+{
+	const unsigned char *p = (const unsigned char*)data;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+ShadowCubeMap::ShadowCubeMap() : texture(0), framebuffer(0), size(0), nearplane(0.f), farplane(0.f),
+	program(0), modelID(-1), facematrixID(-1), lightID(-1), spinaxisID(-1), spinpivotID(-1)
+{
+	invalidate();
+}
+
+ShadowCubeMap::~ShadowCubeMap()
+{
+}
+
+void ShadowCubeMap::create(GLuint facesize, GLfloat nearp, GLfloat farp)
+{
+	size = facesize;
+	nearplane = nearp;
+	farplane = farp;
+
+	/* Linear filtering with comparison gives 2x2 percentage closer filtering for free */
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	for (GLuint f = 0; f < 6; f++)
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_DEPTH_COMPONENT32F, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	/* Depth only, the face is attached when it is rendered */
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	faceprojection = perspective(radians(90.f), 1.f, nearplane, farplane);
+	invalidate();
+}
+
+void ShadowCubeMap::invalidate()
+{
+	for (GLuint f = 0; f < 6; f++)
+		facevalid[f] = false;
+}
+
+/* The face frustum is the pyramid between the four planes through the light at 45 degrees to
+   the face direction, out to the far plane. The sphere is in it unless it is wholly outside
+   one of them */
+bool ShadowCubeMap::inFace(GLuint face, const vec3 &light, const ShadowCaster &caster) const
+{
+	vec3 direction = FACE_DIRECTIONS[face], up = FACE_UPS[face];
+	vec3 across = cross(direction, up);
+	vec3 centre = caster.centre - light;
+
+	GLfloat depth = dot(direction, centre);
+	if (depth < -caster.radius || depth > farplane + caster.radius)
+		return false;
+
+	/* Each side plane has normal (direction +- side) / sqrt(2), pointing into the frustum */
+	GLfloat slack = caster.radius * 1.41421356f;
+	GLfloat x = dot(across, centre), y = dot(up, centre);
+	return depth - x > -slack && depth + x > -slack && depth - y > -slack && depth + y > -slack;
+}
+
+GLuint ShadowCubeMap::update(GLuint newprogram, const vec3 &light, GLfloat time, const ShadowCaster *casters,
+	size_t numcasters, const function<void(size_t)> &draw)
+{
+	if (newprogram != program)
+	{
+		program = newprogram;
+		modelID = glGetUniformLocation(program, "model");
+		facematrixID = glGetUniformLocation(program, "facematrix");
+		lightID = glGetUniformLocation(program, "shadowlight");
+		spinaxisID = glGetUniformLocation(program, "spinaxis");
+		spinpivotID = glGetUniformLocation(program, "spinpivot");
+		invalidate();
+	}
+
+	GLint viewport[4];
+	bool rendering = false;
+	GLuint rendered = 0;
+	for (GLuint f = 0; f < 6; f++)
+	{
+		/* The face only needs drawing again if the light or anything in it has changed */
+		uint64_t hash = 14695981039346656037ULL;
+		hashBytes(hash, &light[0], sizeof(light));
+		facecasters.clear();
+		for (size_t c = 0; c < numcasters; c++)
+		{
+			if (!inFace(f, light, casters[c]))
+				continue;
+			facecasters.push_back(c);
+			hashBytes(hash, &c, sizeof(c));
+			hashBytes(hash, &casters[c].model[0][0], sizeof(mat4));
+			GLfloat angle = casters[c].spin.angle(time);
+			hashBytes(hash, &casters[c].spin.axis[0], sizeof(vec3));
+			hashBytes(hash, &casters[c].spin.pivot[0], sizeof(vec3));
+			hashBytes(hash, &angle, sizeof(angle));
+		}
+		if (facevalid[f] && facehash[f] == hash)
+			continue;
+
+		if (!rendering)
+		{
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glViewport(0, 0, size, size);
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			glEnable(GL_DEPTH_TEST);
+			glUseProgram(program);
+			glUniform3fv(lightID, 1, &light[0]);
+			rendering = true;
+		}
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, texture, 0);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		mat4 facematrix = faceprojection * lookAt(light, light + FACE_DIRECTIONS[f], FACE_UPS[f]);
+		glUniformMatrix4fv(facematrixID, 1, GL_FALSE, &facematrix[0][0]);
+		for (size_t i = 0; i < facecasters.size(); i++)
+		{
+			glUniformMatrix4fv(modelID, 1, GL_FALSE, &casters[facecasters[i]].model[0][0]);
+			casters[facecasters[i]].spin.setUniforms(spinaxisID, spinpivotID);
+			draw(facecasters[i]);
+		}
+
+		facehash[f] = hash;
+		facevalid[f] = true;
+		rendered++;
+	}
+
+	if (rendering)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+	return rendered;
+}
+
+void ShadowCubeMap::bind()
+{
+	glActiveTexture(GL_TEXTURE0 + UNIT);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glActiveTexture(GL_TEXTURE0);
+}
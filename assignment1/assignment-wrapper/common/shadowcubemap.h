@@ -0,0 +1,70 @@
+/* shadowcubemap.h
+ Omnidirectional shadow map for the main light: the distance from the light to the nearest
+ caster in every direction, rendered into the six faces of a depth cube map. Rendering a face
+ is a whole extra scene pass, so each face is cached and only drawn again when the light moves
+ or a caster inside that face's frustum moves (or leaves it). With a still light and scene the
+ shadows cost one texture lookup per pixel and no extra passes.
+ The faces hold distance / far plane, written by shadow.frag and read by shadow.glsl
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "spin.h"
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+/* Something that casts a shadow, with a bounding sphere in world space to find the faces it
+   is in. A spinning caster is turned by shadow.vert and moves every frame */
+struct ShadowCaster
+{
+	glm::mat4 model;
+	Spin spin;
+	glm::vec3 centre;
+	GLfloat radius;
+};
+
+class ShadowCubeMap
+{
+public:
+	/* Texture unit of the cube map, set in shadow.glsl with layout(binding = n) */
+	static const GLuint UNIT = 7;
+
+	ShadowCubeMap();
+	~ShadowCubeMap();
+
+	/* Create the cube map and framebuffer. size is the width of a face in texels and nothing
+	   beyond farplane from the light casts a shadow */
+	void create(GLuint size, GLfloat nearplane, GLfloat farplane);
+
+	/* Render the faces that have changed with program (shadow.vert and shadow.frag), calling
+	   draw(c) to draw caster c of the numcasters in casters once its model matrix has been set.
+	   time is the frame time the spins are turned to. Returns the number of faces rendered.
+	   A different program than last time renders every face */
+	GLuint update(GLuint program, const glm::vec3 &light, GLfloat time, const ShadowCaster *casters,
+		size_t numcasters, const std::function<void(size_t)> &draw);
+
+	/* Render every face on the next update */
+	void invalidate();
+
+	/* Bind the cube map to its unit */
+	void bind();
+
+	GLuint texture;
+	GLuint framebuffer;
+	GLuint size;
+	GLfloat nearplane, farplane;
+
+private:
+	bool inFace(GLuint face, const glm::vec3 &light, const ShadowCaster &caster) const;
+
+	glm::mat4 faceprojection;
+	unsigned long long facehash[6];	// Light and casters the face was last rendered with
+	bool facevalid[6];
+	std::vector<size_t> facecasters;
+
+	GLuint program;
+	GLint modelID, facematrixID, lightID, spinaxisID, spinpivotID;
+};
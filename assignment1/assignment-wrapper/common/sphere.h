@@ -7,6 +7,8 @@
 #pragma once
 
 #include "wrapper_glfw.h"
+#include "meshbuilder.h"
+#include "meshdraw.h"
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -16,23 +18,38 @@ public:
 	Sphere();
 	~Sphere();
 
-	void makeSphere(GLuint numlats, GLuint numlongs, glm::vec3 colour);
+	/* numlods is how many levels of detail to generate, 1 for only the full sphere */
+	void makeSphere(GLuint numlats, GLuint numlongs, glm::vec3 colour, GLuint numlods = MeshLods::MAX_LEVELS);
+	void makeSphere(GLuint numlats, GLuint numlongs, glm::vec3 colour, MeshBuilder &builder,
+		GLuint numlods = MeshLods::MAX_LEVELS);
 	void drawSphere(int drawmode);
 
+	/* Smallest numlats, with numlongs = 2 * numlats so the quads at the equator are square, whose
+	   maximum distance from the true unit sphere is below maxerror. Matches Icosphere::levelsForError */
+	static void resolutionForError(GLfloat maxerror, GLuint &numlats, GLuint &numlongs);
+
 	// Define vertex buffer object names (e.g as globals)
+	// The buffers are shared with every other sphere of the same resolution
 	GLuint sphereBufferObject;
-	GLuint sphereNormals;
-	GLuint sphereColours;
 	GLuint elementbuffer;
+	GLenum indextype;		// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT depending on the number of vertices
+
+	// Single colour for the whole sphere, set as a constant vertex attribute when drawing
+	glm::vec4 colour;
 
 	GLuint attribute_v_coord;
 	GLuint attribute_v_normal;
 	GLuint attribute_v_colours;
 
+	// Buffers, layout and colour as data for the command buffers, see meshdraw.h
+	MeshDraw meshdraw;
+
 	int numspherevertices;
+	int numsphereindices;
 	int numlats;
 	int numlongs;
 
 private:
-	void makeUnitSphere(GLfloat *pVertices);
+	/* Generate the vertices and indices without any GL calls, so it can run on a worker thread */
+	static void defineSphere(GLuint numlats, GLuint numlongs, GLuint numlods, MeshData &mesh);
 };
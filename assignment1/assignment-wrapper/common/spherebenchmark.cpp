@@ -0,0 +1,152 @@
+/* spherebenchmark.cpp
+ UV sphere against icosphere at matched geometric error
+ Andres Alvarez Olmo 2021
+*/
+
+#include "spherebenchmark.h"
+#include "sphere.h"
+#include "icosphere.h"
+#include "asyncprogram.h"
+#include "meshfile.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+/* Maximum distances from the unit sphere the two meshes are matched at */
+const GLfloat ERRORS[] = { 0.05f, 0.01f, 0.002f, 0.0005f };
+
+/* Draws of each mesh inside one timer query, so the time per draw is well above the timer's resolution */
+const int TIMED_DRAWS = 100;
+
+/* Just the positions, scaled to fill most of the viewport, so both meshes cover the same pixels */
+static const char *vertexsource =
+	"#version 420 core\n"
+	"layout(location = 0) in vec4 position;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(position.xyz * 0.9, 1.0);\n"
+	"}\n";
+
+static const char *fragmentsource =
+	"#version 420 core\n"
+	"out vec4 outputColor;\n"
+	"void main()\n"
+	"{\n"
+	"	outputColor = vec4(1.0);\n"
+	"}\n";
+
+static double milliseconds(chrono::steady_clock::duration d)
+{
+	return chrono::duration<double, milli>(d).count();
+}
+
+/* Time of one draw in milliseconds, from the timer query and from the clock on this thread up
+   to glFinish. Software renderers rasterise when the draws are flushed, which the timer query
+   can miss, so the wall time is the one to compare there */
+static void drawTime(GLuint query, const function<void()> &draw, double &gpu, double &wall)
+{
+	draw();		// Once outside the timing so first use costs are not counted
+	glFinish();
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	for (int d = 0; d < TIMED_DRAWS; d++)
+		draw();
+	glFinish();
+	glEndQuery(GL_TIME_ELAPSED);
+	wall = milliseconds(chrono::steady_clock::now() - start) / TIMED_DRAWS;
+
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+	gpu = nanoseconds / 1e6 / TIMED_DRAWS;
+}
+
+static void printHeading()
+{
+	cout << left << setw(11) << "Mesh" << setw(10) << "Size" << right << setw(10) << "Vertices"
+		<< setw(10) << "Indices" << setw(14) << "Generate ms" << setw(10) << "GPU ms" << setw(10) << "Wall ms" << endl;
+}
+
+static void printRow(const char *name, const string &resolution, GLuint vertices, GLuint indices,
+	double generate, double gpu, double wall)
+{
+	cout << left << setw(11) << name << setw(10) << resolution << right
+		<< setw(10) << vertices << setw(10) << indices
+		<< setw(14) << generate << setw(10) << gpu << setw(10) << wall << endl;
+}
+
+void SphereBenchmark::run()
+{
+	AsyncProgram program;
+	program.compile(vertexsource, fragmentsource);
+	while (!program.poll())
+		;
+	if (program.failed())
+	{
+		cout << "Sphere benchmark: could not build the program" << endl << program.log << endl;
+		return;
+	}
+
+	/* Time the generators, not the disk cache */
+	string cachedirectory = MeshFile::directory;
+	MeshFile::directory = "";
+
+	GLuint vao, query;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenQueries(1, &query);
+	glUseProgram(program.program);
+
+	/* No depth test, every draw shades the whole sphere rather than failing against the last one */
+	glDisable(GL_DEPTH_TEST);
+
+	ios::fmtflags flags = cout.flags();
+	streamsize precision = cout.precision();
+	cout << fixed << setprecision(4);
+	for (size_t e = 0; e < sizeof(ERRORS) / sizeof(ERRORS[0]); e++)
+	{
+		GLuint numlats, numlongs;
+		Sphere::resolutionForError(ERRORS[e], numlats, numlongs);
+		GLuint levels = Icosphere::levelsForError(ERRORS[e]);
+
+		/* The mesh builder prints its optimiser report, keep the table below it. The icosphere
+		   has no levels of detail, so neither does the UV sphere, or generating it would include
+		   simplifying them */
+		Sphere sphere;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		sphere.makeSphere(numlats, numlongs, glm::vec3(1.f), 1);
+		glFinish();
+		double spheregenerate = milliseconds(chrono::steady_clock::now() - start);
+
+		Icosphere icosphere;
+		start = chrono::steady_clock::now();
+		icosphere.makeIcosphere(levels, glm::vec3(1.f));
+		glFinish();
+		double icospheregenerate = milliseconds(chrono::steady_clock::now() - start);
+
+		double spheregpu, spherewall, icospheregpu, icospherewall;
+		drawTime(query, [&sphere]() { sphere.drawSphere(0); }, spheregpu, spherewall);
+		drawTime(query, [&icosphere]() { icosphere.drawIcosphere(0); }, icospheregpu, icospherewall);
+
+		cout << endl << "Maximum error " << ERRORS[e] << endl;
+		printHeading();
+		printRow("UV sphere", to_string(numlats) + "x" + to_string(numlongs),
+			sphere.numspherevertices, sphere.numsphereindices, spheregenerate, spheregpu, spherewall);
+		printRow("Icosphere", "level " + to_string(levels),
+			icosphere.numvertices, icosphere.numindices, icospheregenerate, icospheregpu, icospherewall);
+	}
+	cout.flags(flags);
+	cout.precision(precision);
+
+	MeshFile::directory = cachedirectory;
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(0);
+	glDeleteProgram(program.detach());
+	glDeleteQueries(1, &query);
+	glBindVertexArray(0);
+	glDeleteVertexArrays(1, &vao);
+}
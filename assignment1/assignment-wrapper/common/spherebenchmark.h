@@ -0,0 +1,18 @@
+/* spherebenchmark.h
+ Compares the UV sphere with the icosphere at the same maximum distance from the true sphere:
+ vertex and index counts, wall time to generate and upload each mesh, and GPU time to draw it
+ measured with timer queries. Run with: assignment1 --benchmark-spheres
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+
+class SphereBenchmark
+{
+public:
+	/* Print one row per error level for each mesh. Needs a current GL context, draws into
+	   whatever framebuffer is bound and leaves depth testing on, as the scene wants it */
+	static void run();
+};
@@ -0,0 +1,53 @@
+/* spin.h
+ Animation of a rigid part turning at a constant speed about a fixed axis. The angle is a pure
+ function of time, so rather than stepping it and rebuilding the part's matrices every frame
+ the vertex shader (animation.glsl) turns the part from the time in the frame block. Its
+ model matrix stays the same, and the CPU only touches the spin when it starts or stops.
+ A default Spin has no axis and no speed, which shaders treat as no rotation
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <glm/glm.hpp>
+#include "glm/gtc/matrix_transform.hpp"
+
+struct Spin
+{
+	glm::vec3 axis;			// World space unit axis
+	GLfloat speed;			// Radians per second, right handed about the axis
+	glm::vec3 pivot;		// World space point on the axis
+	GLfloat startangle;		// Angle in radians at time 0
+
+	Spin() : axis(0.f), speed(0.f), pivot(0.f), startangle(0.f)
+	{
+	}
+
+	/* Turn at speed from no rotation at time start */
+	Spin(const glm::vec3 &axis, const glm::vec3 &pivot, GLfloat speed, GLfloat start)
+		: axis(axis), speed(speed), pivot(pivot), startangle(-speed * start)
+	{
+	}
+
+	GLfloat angle(GLfloat time) const
+	{
+		return startangle + speed * time;
+	}
+
+	/* The same rotation on the CPU, for the few places that need to know where the part is */
+	glm::mat4 matrix(GLfloat time) const
+	{
+		if (speed == 0.f && startangle == 0.f)
+			return glm::mat4(1.f);
+		return glm::translate(glm::mat4(1.f), pivot) * glm::rotate(glm::mat4(1.f), angle(time), axis) *
+			glm::translate(glm::mat4(1.f), -pivot);
+	}
+
+	/* Send the spin to the spinaxis and spinpivot uniforms of animation.glsl */
+	void setUniforms(GLint axisID, GLint pivotID) const
+	{
+		glUniform4f(axisID, axis.x, axis.y, axis.z, speed);
+		glUniform4f(pivotID, pivot.x, pivot.y, pivot.z, startangle);
+	}
+};
@@ -4,9 +4,24 @@
 */
 
 #include "square.h"
+#include "constgeometry.h"
 
 using namespace std;
 
+/* Vertices for a square in 2 triangles */
+static constexpr ConstVec3 SQUARE_POSITIONS[] = {
+	{ -0.25f, 0.25f, -0.25f },
+	{ -0.25f, -0.25f, -0.25f },
+	{ 0.25f, -0.25f, -0.25f },
+
+	{ 0.25f, -0.25f, -0.25f },
+	{ 0.25f, 0.25f, -0.25f },
+	{ -0.25f, 0.25f, -0.25f }
+};
+
+/* Positions and normals, with the normals calculated from the cross product by the compiler */
+static constexpr FlatTriangles<6> SQUARE_VERTICES = flatShade(SQUARE_POSITIONS);
+
 /* Define the vertex attributes for vertex positions and normals.
 Make these match your application and vertex shader
 You might also want to add colours and texture coordinates */
@@ -22,94 +37,29 @@ Square::~Square()
 {
 }
 
-/* Make a square from hard-coded vertex positions */
+/* Make a square from the hard-coded vertex table */
 void Square::makeSquare()
 {
-	/* Define vertices for a square in 2 triangles */
-	glm::vec3 vertexPositions[] = {
-		glm::vec3(-0.25f, 0.25f, -0.25f),
-		glm::vec3(-0.25f, -0.25f, -0.25f),
-		glm::vec3(0.25f, -0.25f, -0.25f),
-
-		glm::vec3(0.25f, -0.25f, -0.25f),
-		glm::vec3(0.25f, 0.25f, -0.25f),
-		glm::vec3(-0.25f, 0.25f, -0.25f)
-	};
-
-	/* Manually specified colours for our square */
-	float vertexColours[] = {
-		1.0f, 1.0f, 1.0, 1.0f,
-		1.0f, 1.0f, 1.0, 1.0f,
-		1.0f, 1.0f, 1.0, 1.0f,
-		1.0f, 1.0f, 1.0, 1.0f,
-		1.0f, 1.0f, 1.0, 1.0f,
-		1.0f, 1.0f, 1.0, 1.0f,
-	};
-
-
-	glm::vec3 normals[12];
-
-	//Calculate the normals of our vertex using the cross product
-	for (int v = 0; v < numvertices; v += 3)
-	{
-		glm::vec3 normal = glm::cross(vertexPositions[v + 1] - vertexPositions[v],
-			vertexPositions[v + 2] - vertexPositions[v]);
-			normals[v] = normals[v + 1] = normals[v + 2] = normal;
-	}
-
-	/* Create the vertex buffer for the square */
+	/* Create the interleaved vertex buffer for the square straight from the table */
 	glGenBuffers(1, &positionBufferObject);
 	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, numvertices * sizeof(glm::vec3), &vertexPositions[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(SQUARE_VERTICES), &SQUARE_VERTICES, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	/* Create the colours buffer for the square */
-	glGenBuffers(1, &colourObject);
-	glBindBuffer(GL_ARRAY_BUFFER, colourObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexColours), vertexColours, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	/* Create the normals  buffer for the square */
-	glGenBuffers(1, &normalsBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(normals), &normals[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	/* Interleaved positions and normals drawn straight from the vertices, white all over */
+	VertexAttribute position = { attribute_v_coord, 3, GL_FLOAT, GL_FALSE, offsetof(FlatVertex, position) };
+	VertexAttribute normal = { attribute_v_normal, 3, GL_FLOAT, GL_FALSE, offsetof(FlatVertex, normal) };
+	meshdraw.setBuffers(positionBufferObject, 0, GL_UNSIGNED_INT, numvertices, MeshLods::whole(numvertices));
+	meshdraw.binding.stride = sizeof(FlatVertex);
+	meshdraw.binding.position = position;
+	meshdraw.binding.normal = normal;
+	meshdraw.binding.colour.location = attribute_v_colours;
+	meshdraw.colour = glm::vec4(1.f);
 }
 
 
 /* Draw the square by bining the VBOs and drawing triangles */
 void Square::drawSquare(int drawmode)
 {
-	/* Bind square vertices. Note that this is in attribute index attribute_v_coord */
-	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
-	glEnableVertexAttribArray(attribute_v_coord);
-	glVertexAttribPointer(attribute_v_coord, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	/* Bind square colours. Note that this is in attribute index attribute_v_colours */
-	glBindBuffer(GL_ARRAY_BUFFER, colourObject);
-	glEnableVertexAttribArray(attribute_v_colours);
-	glVertexAttribPointer(attribute_v_colours, 4, GL_FLOAT, GL_FALSE, 0, 0);
-
-	/* Bind square normals. Note that this is in attribute index attribute_v_normal */
-	glEnableVertexAttribArray(attribute_v_normal);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsBufferObject);
-	glVertexAttribPointer(attribute_v_normal, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glPointSize(3.f);
-
-	// Switch between filled and wireframe modes
-	if (drawmode == 1)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	else
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Draw points
-	if (drawmode == 2)
-	{
-		glDrawArrays(GL_POINTS, 0, numvertices * 3);
-	}
-	else // Draw the sqiare in triangles
-	{
-		glDrawArrays(GL_TRIANGLES, 0, numvertices * 3);
-	}
+	meshdraw.draw(drawmode);
 }
\ No newline at end of file
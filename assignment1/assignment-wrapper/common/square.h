@@ -6,6 +6,7 @@ Andres Alvarez Olmo
 #pragma once
 
 #include "wrapper_glfw.h"
+#include "meshdraw.h"
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -19,10 +20,9 @@ public:
 	void makeSquare();
 	void drawSquare(int drawmode);
 
-	// Define vertex buffer object names 
+	// Define vertex buffer object names
+	// Positions and normals are interleaved in one buffer, the colour is a constant attribute
 	GLuint positionBufferObject;
-	GLuint colourObject;
-	GLuint normalsBufferObject;
 
 	GLuint attribute_v_coord;
 	GLuint attribute_v_normal;
@@ -30,4 +30,7 @@ public:
 
 	int numvertices;
 
+	// Buffer, layout and colour as data for the command buffers, see meshdraw.h
+	MeshDraw meshdraw;
+
 };
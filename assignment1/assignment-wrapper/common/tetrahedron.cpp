@@ -4,11 +4,46 @@
 */
 
 #include "tetrahedron.h"
+#include "constgeometry.h"
 
 /* I don't like using namespaces in header files but have less issues with them in
 seperate cpp files */
 using namespace std;
 
+/*
+Vertices and normals for a tetrahedron
+which has side lengths of 1 and sits on the plane y=0. It is not centred on the origin
+	A = (0, 1 / sqrt(3), 0)
+	B = (0, 0, -1 / 2sqrt(3))
+	C = (-0.5, 0, 1 / 2sqrt(3))
+	D = (0.5, 0, 1 / 2sqrt(3))
+ Triangles: ACD, ADB, DCB & ABC
+*/
+static constexpr ConstVec3 TETRA_POSITIONS[] = {
+	{ 0, 0.577f, 0 }, { -0.5f, 0, 0.289f }, { 0.5f, 0, 0.289f },
+	{ 0, 0.577f, 0 }, { 0.5f, 0, 0.289f }, { 0, 0, -0.289f },
+	{ 0.5f, 0, 0.289f }, { -0.5f, 0, 0.289f }, { 0, 0, -0.289f },
+	{ 0, 0.577f, 0 }, { 0, 0, -0.289f }, { -0.5f, 0, 0.289f }
+};
+
+/* Each set of three normals is the same for flat shading, calculated by the compiler */
+static constexpr FlatTriangles<12> TETRA_VERTICES = flatShade(TETRA_POSITIONS);
+
+/* Twelve colours for the four flat shaded faces */
+static const GLfloat TETRA_COLOURS[] = {
+	0.0f, 0.0f, 1.0f, 1.0f,
+	0.0f, 0.0f, 1.0f, 1.0f,
+	0.0f, 0.0f, 1.0f, 1.0f,
+	1.0f, 0.0f, 1.0f, 1.0f,
+	1.0f, 0.0f, 1.0f, 1.0f,
+	1.0f, 0.0f, 1.0f, 1.0f,
+	0.0f, 1.0f, 0.0f, 1.0f,
+	0.0f, 1.0f, 0.0f, 1.0f,
+	0.0f, 1.0f, 0.0f, 1.0f,
+	1.0f, 1.0f, 0.0f, 1.0f,
+	1.0f, 1.0f, 0.0f, 1.0f,
+	1.0f, 1.0f, 0.0f, 1.0f };
+
 /* Define the vertex attributes for vertex positions and normals.
 Make these match your application and vertex shader
 You might also want to add colours and texture coordinates */
@@ -26,69 +61,19 @@ Tetrahedron::~Tetrahedron()
 }
 
 
-/*
-Define the vertices, normals and indices for a tetrahedron
-which has side lengths of 1 and sits on the plane y=0. It is not centred on the origin
-	A = (0, 1 / sqrt(3), 0)
-	B = (0, 0, -1 / 2sqrt(3))
-	C = (-0.5, 0, 1 / 2sqrt(3))
-	D = (0.5, 0, 1 / 2sqrt(3))
- Triangles: ADC, ABD, DBC & ACB
-*/
+/* Upload the tetrahedron buffers straight from the static tables */
 void Tetrahedron::defineTetrahedron()
 {
-	glm::vec3 tetra_normals[12];	// Array for normals for flat shaded tetrahedorn
-
-	// Define vertices as glm:vec3 type to make it easier to calculate normals
-	glm::vec3 tetra_vertices[] = {
-		glm::vec3(0, 0.577f, 0), glm::vec3(-0.5f, 0, 0.289f), glm::vec3(0.5f, 0, 0.289f),
-		glm::vec3(0, 0.577f, 0), glm::vec3(0.5f, 0, 0.289f), glm::vec3(0, 0, -0.289f),
-		glm::vec3(0.5f, 0, 0.289f), glm::vec3(-0.5f, 0, 0.289f), glm::vec3(0, 0, -0.289f),
-		glm::vec3(0, 0.577f, 0), glm::vec3(0, 0, -0.289f), glm::vec3(-0.5f, 0, 0.289f)
-	};
-
-	/* Specify the vertex buffer */
-	/* Note how we pass the array of glm::vec3. The data gets copied here so it's ok that
-	   terta_vertices is local */
+	/* Specify the interleaved vertex and normal buffer */
 	glGenBuffers(1, &tetra_buffer_vertices);
 	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_vertices);
-	glBufferData(GL_ARRAY_BUFFER, numvertices * sizeof(glm::vec3), &tetra_vertices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(TETRA_VERTICES), &TETRA_VERTICES, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	/* Define twelve colours for the four flat shaded object */
-	GLfloat tetra_colours[] = {
-		0.0f, 0.0f, 1.0f, 1.0f,
-		0.0f, 0.0f, 1.0f, 1.0f,
-		0.0f, 0.0f, 1.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 1.0f,
-		0.0f, 1.0f, 0.0f, 1.0f,
-		0.0f, 1.0f, 0.0f, 1.0f,
-		0.0f, 1.0f, 0.0f, 1.0f,
-		1.0f, 1.0f, 0.0f, 1.0f,
-		1.0f, 1.0f, 0.0f, 1.0f,
-		1.0f, 1.0f, 0.0f, 1.0f };
-
 	/* Specify the colour buffer */
 	glGenBuffers(1, &tetra_buffer_colours);
 	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_colours);
-	glBufferData(GL_ARRAY_BUFFER, numvertices * sizeof(GLfloat) * 4, &tetra_colours[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	// Calculate the normals for each triangle, then set each set of three normals to be the same
-	// for flat shading
-	for (int v = 0; v < numvertices; v+=3)
-	{
-		glm::vec3 normal = glm::cross(tetra_vertices[v + 1] - tetra_vertices[v],
-									  tetra_vertices[v + 2] - tetra_vertices[v]);
-		tetra_normals[v] = tetra_normals[v + 1] = tetra_normals[v + 2] = normal;
-	}
-	
-	/* Define a buffer of the vertex normals */
-	glGenBuffers(1, &tetra_buffer_normals);
-	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_normals);
-	glBufferData(GL_ARRAY_BUFFER, numvertices * sizeof(glm::vec3), &tetra_normals[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(TETRA_COLOURS), TETRA_COLOURS, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -98,17 +83,17 @@ void Tetrahedron::drawTetrahedron(int drawmode)
 	/* Bind the vertices */
 	glEnableVertexAttribArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_vertices);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(FlatVertex), (void*)offsetof(FlatVertex, position));
 
 	/* Bind the colours */
 	glEnableVertexAttribArray(1);
 	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_colours);
 	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-	/* Bind the normals */
+	/* Bind the normals, interleaved with the vertices */
 	glEnableVertexAttribArray(2);
-	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_normals);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, tetra_buffer_vertices);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(FlatVertex), (void*)offsetof(FlatVertex, normal));
 
 	// Enable this line to show model in wireframe
 	if (drawmode == 1)
@@ -17,14 +17,10 @@ public:
 
 	/* function prototypes */
 	void defineTetrahedron();
-	void drawTetrahedron();
-
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> normals;
-	std::vector<GLushort> elements;
+	void drawTetrahedron(int drawmode);
 
 	// Define vertex buffer object names (e.g as globals)
-	GLuint tetra_buffer_normals;
+	// The vertex buffer holds the normals too
 	GLuint tetra_buffer_vertices;
 	GLuint tetra_buffer_colours;
 
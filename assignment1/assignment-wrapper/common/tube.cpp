@@ -0,0 +1,329 @@
+/* tube.cpp
+ Class to create a tube by sweeping a circle along a path, streamed into mapped buffers
+ Andres Alvarez Olmo 2021
+*/
+
+#include "tube.h"
+#include "packedvertex.h"
+#include "indexbuffer.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+using namespace glm;
+
+/* Number of times to rewrite a buffer whose contents were lost while it was mapped */
+const int MAP_RETRIES = 3;
+
+/* Packed positions move by up to VertexPacking::POSITION_ERROR. Rings closer together than
+   this many times that get float positions, so the packing stays a small part of a triangle */
+const GLfloat MIN_PACKED_GAP = 100.f;
+
+/* Smallest step of t the tangent is measured over. The path gives float positions, and over
+   the steps of a very long sweep their rounding would turn the tangent and wobble the rings */
+const double MIN_TANGENT_STEP = 1.0 / 1024;
+
+Tube::Tube()
+{
+	attribute_v_coord = 0;
+	attribute_v_colours = 1;
+	attribute_v_normal = 2;
+	vertexBufferObject = 0;
+	elementbuffer = 0;
+	indextype = GL_UNSIGNED_INT;
+	numvertices = 0;
+	numindices = 0;
+}
+
+Tube::~Tube()
+{
+}
+
+void Tube::makeTorus(GLfloat majorradius, GLfloat minorradius, GLuint segments, GLuint sides, vec3 colour)
+{
+	assert(majorradius + minorradius <= 1.f);
+
+	/* Tori with the same shape share the same buffers */
+	string key = "torus:" + to_string(majorradius) + "," + to_string(minorradius) + ":" + to_string(segments) + "x" + to_string(sides);
+	MeshBuffers* mesh = MeshCache::find(key);
+	if (mesh)
+	{
+		this->colour = vec4(colour, 1.f);
+		vertexBufferObject = mesh->positions;
+		elementbuffer = mesh->elements;
+		indextype = mesh->indextype;
+		numvertices = mesh->numvertices;
+		numindices = mesh->numindices;
+		useBuffers(mesh->vertexstride);
+		return;
+	}
+
+	/* A torus that couldn't be written isn't cached, so the next one tries again */
+	const GLfloat TWO_PI = 6.2831853f;
+	if (!makeTube([majorradius, TWO_PI](GLfloat t) { return vec3(majorradius * cos(TWO_PI * t), 0.f, majorradius * sin(TWO_PI * t)); },
+		minorradius, segments, sides, true, colour))
+		return;
+
+	mesh = MeshCache::insert(key);
+	mesh->positions = mesh->normals = vertexBufferObject;
+	mesh->elements = elementbuffer;
+	mesh->indextype = indextype;
+	mesh->numvertices = numvertices;
+	mesh->vertexstride = meshdraw.binding.stride;
+	mesh->numindices = numindices;
+	mesh->lods = MeshLods::whole(numindices);
+}
+
+bool Tube::makeTube(const TubePath &path, GLfloat radius, GLuint segments, GLuint sides, bool closed, vec3 colour)
+{
+	this->colour = vec4(colour, 1.f);
+
+	TubeSweep sweep = plan(path, radius, segments, sides, closed);
+	numvertices = sweep.numvertices;
+	numindices = sweep.numindices;
+	indextype = IndexBuffer::typeFor(numvertices);
+
+	/* Allocate the buffers without any data, then map them and write the mesh straight in */
+	glGenBuffers(1, &vertexBufferObject);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)numvertices * sweep.vertexsize, NULL, GL_STATIC_DRAW);
+	bool written = writeBuffer(GL_ARRAY_BUFFER, (GLsizeiptr)numvertices * sweep.vertexsize,
+		[&sweep, &path](void *out) { writeVertices(out, sweep, path); });
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (!written)
+		cerr << "Tube: could not write the vertex buffer" << endl;
+
+	glGenBuffers(1, &elementbuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)numindices * IndexBuffer::typeSize(indextype), NULL, GL_STATIC_DRAW);
+	GLenum type = indextype;
+	if (written && !writeBuffer(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)numindices * IndexBuffer::typeSize(indextype),
+		[&sweep, type](void *out) { writeIndices(out, sweep, type); }))
+	{
+		cerr << "Tube: could not write the index buffer" << endl;
+		written = false;
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	/* Draw nothing rather than whatever the buffers were left holding */
+	if (!written)
+	{
+		glDeleteBuffers(1, &vertexBufferObject);
+		glDeleteBuffers(1, &elementbuffer);
+		vertexBufferObject = elementbuffer = 0;
+		numvertices = numindices = 0;
+	}
+	useBuffers(sweep.vertexsize);
+	return written;
+}
+
+bool Tube::writeBuffer(GLenum target, GLsizeiptr size, const function<void(void*)> &write)
+{
+	for (int attempt = 0; attempt < MAP_RETRIES; attempt++)
+	{
+		/* Invalidating tells the driver the old contents are not needed, so it doesn't have to wait or copy */
+		void *out = glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (!out)
+			return false;
+
+		write(out);
+
+		/* Unmapping fails if the buffer was lost while mapped (e.g. a mode switch), then write it again */
+		if (glUnmapBuffer(target))
+			return true;
+	}
+	return false;
+}
+
+void Tube::useBuffers(GLuint vertexsize)
+{
+	meshdraw.setBuffers(vertexBufferObject, elementbuffer, indextype, numvertices, MeshLods::whole(numindices));
+	if (vertexsize == sizeof(PrecisePackedVertex))
+		VertexPacking::describePrecise(attribute_v_coord, attribute_v_normal, meshdraw.binding);
+	else
+		VertexPacking::describe(attribute_v_coord, attribute_v_normal, meshdraw.binding);
+	meshdraw.binding.colour.location = attribute_v_colours;
+	meshdraw.colour = colour;
+}
+
+/* The centre of a ring and the frame it is swept round: the tangent of the path and two
+   directions at right angles to it */
+struct RingFrame
+{
+	vec3 centre, tangent, normal, binormal;
+};
+
+/* Carries a frame along the rings of a sweep. The frame is parallel transported, turned as
+   little as possible from one ring to the next, so the tube doesn't twist as the path bends */
+class FrameWalk
+{
+public:
+	FrameWalk(const TubePath &path, GLuint segments, bool closed) : path(path), segments(segments), closed(closed), normal(0.f)
+	{
+	}
+
+	/* Frame of ring i, called for each ring in turn. Ring segments of a closed path is ring 0
+	   again, reached by going all the way round */
+	void next(GLuint i, RingFrame &frame)
+	{
+		double t = (double)i / segments, step = std::max(1.0 / segments, MIN_TANGENT_STEP);
+		frame.centre = sample(t);
+
+		/* Central difference along the path, one sided at the ends of an open path */
+		double before = closed ? t - step : std::max(t - step, 0.0);
+		double after = closed ? t + step : std::min(t + step, 1.0);
+		frame.tangent = normalize(sample(after) - sample(before));
+
+		/* Start the frame on any direction at right angles to the path, then carry it along */
+		if (i == 0)
+			normal = (abs(frame.tangent.x) < 0.9f) ? vec3(1, 0, 0) : vec3(0, 1, 0);
+		normal = normalize(normal - frame.tangent * dot(normal, frame.tangent));
+		frame.normal = normal;
+		frame.binormal = cross(frame.tangent, normal);
+	}
+
+private:
+	/* Closed paths wrap round into [0, 1), path is only defined there */
+	vec3 sample(double t) const
+	{
+		if (closed)
+			t -= floor(t);
+		return path((GLfloat)t);
+	}
+
+	const TubePath &path;
+	GLuint segments;
+	bool closed;
+	vec3 normal;
+};
+
+/* Closest the vertices of two neighbouring rings get, which is on the inside of a bend */
+static GLfloat ringGap(const RingFrame &a, const RingFrame &b, GLfloat radius)
+{
+	return length(b.centre - a.centre) - radius * length(b.tangent - a.tangent);
+}
+
+TubeSweep Tube::plan(const TubePath &path, GLfloat radius, GLuint segments, GLuint sides, bool closed)
+{
+	TubeSweep sweep;
+	sweep.radius = radius;
+	sweep.segments = segments;
+	sweep.sides = sides;
+	sweep.closed = closed;
+
+	/* Closed tubes reuse the first ring at the end */
+	sweep.numrings = closed ? segments : segments + 1;
+	sweep.numvertices = sweep.numrings * sides;
+	sweep.numindices = segments * sides * 6;
+
+	/* Walk the frames once without writing anything, to find how close the rings get and, for
+	   a closed path, how far the frame has turned when it comes back to the start. The frame
+	   has nothing to keep it in step with the start, so off a plane it comes back turned */
+	FrameWalk walk(path, segments, closed);
+	RingFrame first, previous, frame;
+	walk.next(0, first);
+	previous = first;
+	GLfloat gap = 2.f * radius * sin(3.14159265f / sides);
+	for (GLuint i = 1; i < sweep.numrings; i++)
+	{
+		walk.next(i, frame);
+		gap = std::min(gap, ringGap(previous, frame, radius));
+		previous = frame;
+	}
+
+	sweep.twist = 0.f;
+	if (closed)
+	{
+		walk.next(segments, frame);
+		gap = std::min(gap, ringGap(previous, frame, radius));
+		sweep.twist = atan2(dot(cross(first.normal, frame.normal), first.tangent), dot(first.normal, frame.normal));
+	}
+
+	sweep.precise = gap < MIN_PACKED_GAP * VertexPacking::POSITION_ERROR;
+	sweep.vertexsize = sweep.precise ? sizeof(PrecisePackedVertex) : sizeof(PackedVertex);
+	return sweep;
+}
+
+static void packVertex(PackedVertex &vertex, const vec3 &position, const vec3 &normal)
+{
+	vertex = VertexPacking::pack(position, normal);
+}
+
+static void packVertex(PrecisePackedVertex &vertex, const vec3 &position, const vec3 &normal)
+{
+	vertex = VertexPacking::packPrecise(position, normal);
+}
+
+/* Write the rings one after another. A closed path's twist is taken out a little on each
+   ring, so the last ring lines up with the first one it is joined to */
+template <typename Vertex>
+static void writeRings(Vertex *out, const TubeSweep &sweep, const TubePath &path)
+{
+	vector<vec2> directions(sweep.sides);
+	for (GLuint j = 0; j < sweep.sides; j++)
+	{
+		GLfloat angle = 6.2831853f * j / sweep.sides;
+		directions[j] = vec2(cos(angle), sin(angle));
+	}
+
+	FrameWalk walk(path, sweep.segments, sweep.closed);
+	RingFrame frame;
+	for (GLuint i = 0; i < sweep.numrings; i++)
+	{
+		walk.next(i, frame);
+		GLfloat untwist = -sweep.twist * i / sweep.segments;
+		vec3 normal = frame.normal * cos(untwist) + frame.binormal * sin(untwist);
+		vec3 binormal = cross(frame.tangent, normal);
+
+		for (GLuint j = 0; j < sweep.sides; j++)
+		{
+			vec3 n = normal * directions[j].x + binormal * directions[j].y;
+			packVertex(*out++, frame.centre + n * sweep.radius, n);
+		}
+	}
+}
+
+void Tube::writeVertices(void *out, const TubeSweep &sweep, const TubePath &path)
+{
+	if (sweep.precise)
+		writeRings((PrecisePackedVertex*)out, sweep, path);
+	else
+		writeRings((PackedVertex*)out, sweep, path);
+}
+
+/* Two triangles for each side of each segment, wound anticlockwise when seen from outside */
+template <typename T>
+static void writeTubeIndices(T *out, GLuint segments, GLuint sides, GLuint numrings)
+{
+	for (GLuint i = 0; i < segments; i++)
+	{
+		GLuint ring = i * sides, next = ((i + 1) % numrings) * sides;
+		for (GLuint j = 0; j < sides; j++)
+		{
+			GLuint side = (j + 1) % sides;
+			*out++ = (T)(ring + j); *out++ = (T)(ring + side); *out++ = (T)(next + j);
+			*out++ = (T)(next + j); *out++ = (T)(ring + side); *out++ = (T)(next + side);
+		}
+	}
+}
+
+void Tube::writeIndices(void *out, const TubeSweep &sweep, GLenum indextype)
+{
+	if (indextype == GL_UNSIGNED_BYTE)
+		writeTubeIndices((GLubyte*)out, sweep.segments, sweep.sides, sweep.numrings);
+	else if (indextype == GL_UNSIGNED_SHORT)
+		writeTubeIndices((GLushort*)out, sweep.segments, sweep.sides, sweep.numrings);
+	else
+		writeTubeIndices((GLuint*)out, sweep.segments, sweep.sides, sweep.numrings);
+}
+
+/* Draw the tube as one indexed triangle list in a single colour */
+void Tube::drawTube(int drawmode)
+{
+	if (numvertices)
+		meshdraw.draw(drawmode);
+}
@@ -0,0 +1,82 @@
+/* tube.h
+ Class to create a tube by sweeping a circle along a path, e.g. a torus, a cable or the
+ tonearm wire. The vertices and indices are written straight into mapped buffers one ring
+ at a time, so no copy of the mesh is held in memory however long the path is.
+ Vertices are packed like the other meshes while the rings are far enough apart for the
+ packed positions to tell them apart, and get float positions when they are closer
+ Andres Alvarez Olmo 2021
+*/
+
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "meshcache.h"
+#include "meshdraw.h"
+#include <functional>
+#include <glm/glm.hpp>
+
+/* A path to sweep along, for t from 0 to 1 */
+typedef std::function<glm::vec3(GLfloat)> TubePath;
+
+/* Everything about a sweep that is known before it is written, found by walking the path once */
+struct TubeSweep
+{
+	GLfloat radius;
+	GLuint segments, sides;
+	bool closed;
+	GLuint numrings, numvertices, numindices;
+	GLfloat twist;		// Turn of the carried frame when a closed path gets back to its start, spread over the rings
+	bool precise;		// The rings are too close together to pack their positions, see PrecisePackedVertex
+	GLuint vertexsize;	// sizeof the vertex format used
+};
+
+class Tube
+{
+public:
+	Tube();
+	~Tube();
+
+	/* Torus round the y axis. majorradius + minorradius must be at most 1, scale it with the model matrix */
+	void makeTorus(GLfloat majorradius, GLfloat minorradius, GLuint segments, GLuint sides, glm::vec3 colour);
+
+	/* Sweep a circle of the given radius along path(t) for t from 0 to 1 in segments steps.
+	   Closed paths have path(1) == path(0) and the ends are joined, open ends are left open.
+	   path is only called for t from 0 to 1. The tube must fit inside the unit cube.
+	   Returns false, leaving the tube empty, if the buffers couldn't be written */
+	bool makeTube(const TubePath &path, GLfloat radius, GLuint segments, GLuint sides, bool closed, glm::vec3 colour);
+
+	void drawTube(int drawmode);
+
+	/* Walk path to find the sizes and vertex format of a sweep */
+	static TubeSweep plan(const TubePath &path, GLfloat radius, GLuint segments, GLuint sides, bool closed);
+
+	/* Write the vertices or indices of a sweep to out, which has room for sweep.numvertices
+	   vertices of sweep.vertexsize or sweep.numindices indices of indextype. No GL calls, out
+	   is usually a mapped buffer */
+	static void writeVertices(void *out, const TubeSweep &sweep, const TubePath &path);
+	static void writeIndices(void *out, const TubeSweep &sweep, GLenum indextype);
+
+	// Define vertex buffer object names. Tori with the same parameters share buffers
+	GLuint vertexBufferObject;
+	GLuint elementbuffer;
+	GLenum indextype;
+
+	// Single colour for the whole tube, set as a constant vertex attribute when drawing
+	glm::vec4 colour;
+
+	GLuint attribute_v_coord;
+	GLuint attribute_v_normal;
+	GLuint attribute_v_colours;
+
+	GLuint numvertices;
+	GLuint numindices;
+
+	MeshDraw meshdraw;		// Buffers, layout and colour as data for the command buffers
+
+private:
+	/* Map the buffer bound to target, write size bytes with write and unmap it */
+	static bool writeBuffer(GLenum target, GLsizeiptr size, const std::function<void(void*)> &write);
+
+	/* Point meshdraw at the buffers, in the vertex format with vertexsize bytes */
+	void useBuffers(GLuint vertexsize);
+};
@@ -6,11 +6,12 @@
   */
 
 #include "wrapper_glfw.h"
+#include "programcache.h"
+#include "shaderloader.h"
 
 /* Inlcude some standard headers */
 
 #include <iostream>
-#include <fstream>
 #include <vector>
 
 using namespace std;
@@ -178,24 +179,15 @@ GLuint GLWrapper::BuildShader(GLenum eShaderType, const string &shaderText)
 	return shader;
 }
 
-/* Read a text file into a string*/
+/* Read a text file into a string, in one read rather than line by line */
 string GLWrapper::readFile(const char *filePath)
 {
 	string content;
-	ifstream fileStream(filePath, ios::in);
-
-	if (!fileStream.is_open()) {
+	if (!ShaderLoader::readFile(filePath, content)) {
 		cerr << "Could not read file " << filePath << ". File does not exist." << endl;
 		return "";
 	}
 
-	string line = "";
-	while (!fileStream.eof()) {
-		getline(fileStream, line);
-		content.append(line + "\n");
-	}
-
-	fileStream.close();
 	return content;
 }
 
@@ -208,15 +200,24 @@ GLuint GLWrapper::LoadShader(const char *vertex_path, const char *fragment_path)
 	string vertShaderStr = readFile(vertex_path);
 	string fragShaderStr = readFile(fragment_path);
 
+	// Use the program binary from the last run if the sources and driver are unchanged
+	vector<string> sources;
+	sources.push_back(vertShaderStr);
+	sources.push_back(fragShaderStr);
+	GLuint program = ProgramCache::load(sources);
+	if (program)
+		return program;
+
 	GLint result = GL_FALSE;
 	int logLength;
 
 	vertShader = BuildShader(GL_VERTEX_SHADER, vertShaderStr);
 	fragShader = BuildShader(GL_FRAGMENT_SHADER, fragShaderStr);
 
-	GLuint program = glCreateProgram();
+	program = glCreateProgram();
 	glAttachShader(program, vertShader);
 	glAttachShader(program, fragShader);
+	ProgramCache::retrievable(program);
 	glLinkProgram(program);
 
 	glGetProgramiv(program, GL_LINK_STATUS, &result);
@@ -228,6 +229,9 @@ GLuint GLWrapper::LoadShader(const char *vertex_path, const char *fragment_path)
 	glDeleteShader(vertShader);
 	glDeleteShader(fragShader);
 
+	if (result == GL_TRUE)
+		ProgramCache::save(sources, program);
+
 	return program;
 }
 
@@ -237,6 +241,13 @@ GLuint GLWrapper::BuildShaderProgram(string vertShaderStr, string fragShaderStr)
 	GLuint vertShader, fragShader;
 	GLint result = GL_FALSE;
 
+	vector<string> sources;
+	sources.push_back(vertShaderStr);
+	sources.push_back(fragShaderStr);
+	GLuint program = ProgramCache::load(sources);
+	if (program)
+		return program;
+
 	try
 	{
 		vertShader = BuildShader(GL_VERTEX_SHADER, vertShaderStr);
@@ -248,9 +259,10 @@ GLuint GLWrapper::BuildShaderProgram(string vertShaderStr, string fragShaderStr)
 		throw exception("BuildShaderProgram() Build shader failure. Abandoning");
 	}
 
-	GLuint program = glCreateProgram();
+	program = glCreateProgram();
 	glAttachShader(program, vertShader);
 	glAttachShader(program, fragShader);
+	ProgramCache::retrievable(program);
 	glLinkProgram(program);
 
 	GLint status;
@@ -272,5 +284,6 @@ GLuint GLWrapper::BuildShaderProgram(string vertShaderStr, string fragShaderStr)
 	glDeleteShader(vertShader);
 	glDeleteShader(fragShader);
 
+	ProgramCache::save(sources, program);
 	return program;
 }
\ No newline at end of file
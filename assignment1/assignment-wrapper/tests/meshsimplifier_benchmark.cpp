@@ -0,0 +1,264 @@
+/* meshsimplifier_benchmark.cpp
+ Times the mesh simplifier on large inputs and checks what it produces:
+	a 1M triangle height field down to 50k triangles, keeping its corners and not flipping any face
+	the same number of triangles as eight smaller meshes, one after another and on the worker threads
+	a 200x200 lathe sphere down to 10%, without inverted faces
+	the levels of detail of a cylinder, whose rims are seams, without cracks along them and
+	keeping the notch vertex mixed cylinders colour red
+ Build and run it on its own with optimisations, e.g. from this folder
+   cl /EHsc /O2 /I..\include /I..\common meshsimplifier_benchmark.cpp ..\common\meshsimplifier.cpp
+      ..\common\parallel.cpp ..\common\allocationcounter.cpp
+ Returns 0 when every check passes
+ Andres Alvarez Olmo 2021
+*/
+
+#include "meshsimplifier.h"
+#include "lathe.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace glm;
+
+static int failures = 0;
+
+static void check(bool passed, const char *what)
+{
+	if (!passed)
+	{
+		failures++;
+		cout << "  FAILED: " << what << endl;
+	}
+}
+
+static double seconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* A gently rolling height field over [-1, 1] with size x size quads */
+static void makeGrid(GLuint size, SimplifyMesh &mesh)
+{
+	for (GLuint y = 0; y <= size; y++)
+	{
+		for (GLuint x = 0; x <= size; x++)
+		{
+			GLfloat u = 2.f * x / size - 1.f, v = 2.f * y / size - 1.f;
+			GLfloat h = 0.05f * sin(3.f * u) * cos(3.f * v);
+			vec3 dx(1.f, 0.f, 0.15f * cos(3.f * u) * cos(3.f * v)), dy(0.f, 1.f, -0.15f * sin(3.f * u) * sin(3.f * v));
+			mesh.positions.push_back(vec3(u, v, h));
+			mesh.normals.push_back(normalize(cross(dx, dy)));
+		}
+	}
+	for (GLuint y = 0; y < size; y++)
+	{
+		for (GLuint x = 0; x < size; x++)
+		{
+			GLuint a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			GLuint quad[6] = { a, b, c, c, b, d };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+/* Sweep a profile the way Lathe::define does, keeping the float positions and normals */
+static void makeLathe(const vector<ProfilePoint> &profile, GLuint segments, SimplifyMesh &mesh)
+{
+	LatheSurface surface;
+	surface.segments = segments;
+	for (GLuint j = 0; j < segments; j++)
+	{
+		GLfloat angle = 2.f * 3.14159265f * j / segments;
+		surface.directions.push_back(vec2(cos(angle), sin(angle)));
+		surface.middirections.push_back(vec2(cos(angle), sin(angle)));
+	}
+	SmoothNormals::sweep(profile, surface);
+	mesh.positions.swap(surface.positions);
+	mesh.normals.swap(surface.normals);
+	mesh.indices.swap(surface.indices);
+}
+
+static vec3 faceNormal(const SimplifyMesh &mesh, const GLuint *tri)
+{
+	const vec3 &p0 = mesh.positions[tri[0]], &p1 = mesh.positions[tri[1]], &p2 = mesh.positions[tri[2]];
+	return cross(p1 - p0, p2 - p0);
+}
+
+static bool uses(const vector<GLuint> &indices, const vector<vec3> &positions, const vec3 &position)
+{
+	for (size_t i = 0; i < indices.size(); i++)
+		if (positions[indices[i]] == position)
+			return true;
+	return false;
+}
+
+/* Edges used by other than two triangles once vertices at the same position are welded, which
+   is a crack or hole in a closed mesh */
+static size_t openEdges(const vector<GLuint> &indices, const vector<vec3> &positions)
+{
+	map<pair<GLuint, GLuint>, int> edges;
+	map<pair<GLfloat, pair<GLfloat, GLfloat> >, GLuint> welded;
+	vector<GLuint> weld(positions.size());
+	for (size_t v = 0; v < positions.size(); v++)
+		weld[v] = welded.insert(make_pair(make_pair(positions[v].x, make_pair(positions[v].y, positions[v].z)), (GLuint)v)).first->second;
+
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint a = weld[indices[t + k]], b = weld[indices[t + (k + 1) % 3]];
+			edges[make_pair(std::min(a, b), std::max(a, b))]++;
+		}
+	}
+	size_t open = 0;
+	for (map<pair<GLuint, GLuint>, int>::iterator e = edges.begin(); e != edges.end(); e++)
+		if (e->second != 2)
+			open++;
+	return open;
+}
+
+static void benchmarkGrid()
+{
+	SimplifyMesh mesh;
+	makeGrid(708, mesh);
+	size_t before = mesh.indices.size() / 3;
+	vec3 corners[4] = { vec3(-1.f, -1.f, 0.f), vec3(1.f, -1.f, 0.f), vec3(-1.f, 1.f, 0.f), vec3(1.f, 1.f, 0.f) };
+	for (int c = 0; c < 4; c++)
+		corners[c].z = 0.05f * sin(3.f * corners[c].x) * cos(3.f * corners[c].y);
+
+	SimplifySettings settings;
+	settings.targettriangles = 50000;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	MeshSimplifier::simplify(mesh, settings);
+	double time = seconds(start);
+
+	size_t after = mesh.indices.size() / 3;
+	cout << "Height field: " << before << " -> " << after << " triangles in " << time << " s, error " << mesh.error << endl;
+	check(after <= settings.targettriangles, "the height field reaches the target");
+
+	int kept = 0;
+	for (int c = 0; c < 4; c++)
+		kept += uses(mesh.indices, mesh.positions, corners[c]) ? 1 : 0;
+	check(kept == 4, "the height field keeps its corners");
+
+	size_t flipped = 0;
+	for (size_t t = 0; t < mesh.indices.size(); t += 3)
+		flipped += faceNormal(mesh, &mesh.indices[t]).z <= 0.f ? 1 : 0;
+	check(flipped == 0, "no face of the height field turns over");
+}
+
+static void benchmarkMany()
+{
+	const size_t NUM_MESHES = 8;
+	SimplifyMesh grid;
+	makeGrid(250, grid);
+
+	SimplifySettings settings;
+	settings.targettriangles = grid.indices.size() / 3 / 10;
+
+	vector<SimplifyMesh> serial(NUM_MESHES, grid), parallel(NUM_MESHES, grid);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t m = 0; m < NUM_MESHES; m++)
+		MeshSimplifier::simplify(serial[m], settings);
+	double serialtime = seconds(start);
+
+	start = chrono::steady_clock::now();
+	MeshSimplifier::simplify(parallel, settings);
+	double paralleltime = seconds(start);
+
+	cout << NUM_MESHES << " height fields of " << grid.indices.size() / 3 << " triangles to 10%: " << serialtime
+		<< " s one by one, " << paralleltime << " s on " << std::max(thread::hardware_concurrency(), 1u) << " threads" << endl;
+
+	bool same = true;
+	for (size_t m = 0; m < NUM_MESHES; m++)
+		same = same && serial[m].indices == parallel[m].indices;
+	check(same, "simplifying on the worker threads gives the same meshes");
+}
+
+static void benchmarkSphere()
+{
+	const GLuint RESOLUTION = 200;
+	vector<ProfilePoint> profile(RESOLUTION + 1);
+	for (GLuint i = 0; i <= RESOLUTION; i++)
+	{
+		GLfloat latitude = 3.14159265f * (0.5f - (GLfloat)i / RESOLUTION);
+		profile[i] = ProfilePoint(i == 0 || i == RESOLUTION ? 0.f : cos(latitude), sin(latitude));
+	}
+	SimplifyMesh mesh;
+	makeLathe(profile, RESOLUTION, mesh);
+	size_t before = mesh.indices.size() / 3;
+
+	SimplifySettings settings;
+	settings.targettriangles = before / 10;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	MeshSimplifier::simplify(mesh, settings);
+	double time = seconds(start);
+
+	size_t inverted = 0;
+	for (size_t t = 0; t < mesh.indices.size(); t += 3)
+	{
+		const GLuint *tri = &mesh.indices[t];
+		vec3 centroid = (mesh.positions[tri[0]] + mesh.positions[tri[1]] + mesh.positions[tri[2]]) / 3.f;
+		inverted += dot(faceNormal(mesh, tri), centroid) <= 0.f ? 1 : 0;
+	}
+	cout << "Sphere: " << before << " -> " << mesh.indices.size() / 3 << " triangles in " << time << " s, error "
+		<< mesh.error << ", " << inverted << " inverted" << endl;
+	check(mesh.indices.size() / 3 <= settings.targettriangles, "the sphere reaches the target");
+	check(inverted == 0, "no face of the sphere is inverted");
+	check(openEdges(mesh.indices, mesh.positions) == 0, "the sphere stays closed");
+}
+
+static void benchmarkCylinder()
+{
+	/* The profile of Cylinder::defineCylinder, with a crease at each rim */
+	vector<ProfilePoint> profile = {
+		ProfilePoint(0.f, 0.5f), ProfilePoint(1.f, 0.5f), ProfilePoint(1.f, 0.5f),
+		ProfilePoint(1.f, -0.5f), ProfilePoint(1.f, -0.5f), ProfilePoint(0.f, -0.5f)
+	};
+	SimplifyMesh mesh;
+	makeLathe(profile, 100, mesh);
+	const GLuint NOTCH_VERTEX = 1;	// As in Cylinder
+	mesh.locked.push_back(NOTCH_VERTEX);
+
+	vector<vector<GLuint> > levels;
+	vector<GLfloat> errors;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	MeshSimplifier::levelsOfDetail(mesh, 3, 0.25f, levels, errors);
+	double time = seconds(start);
+
+	cout << "Cylinder levels of detail in " << time << " s: " << mesh.indices.size() / 3;
+	for (size_t l = 0; l < levels.size(); l++)
+		cout << " -> " << levels[l].size() / 3 << " (error " << errors[l] << ")";
+	cout << " triangles" << endl;
+
+	check(levels.size() == 3, "the cylinder has every level of detail");
+	for (size_t l = 0; l < levels.size(); l++)
+	{
+		check(openEdges(levels[l], mesh.positions) == 0, "the lids and side of the cylinder stay joined");
+		check(*max_element(levels[l].begin(), levels[l].end()) < mesh.positions.size(),
+			"the levels of detail index the original vertices");
+		check(find(levels[l].begin(), levels[l].end(), NOTCH_VERTEX) != levels[l].end(),
+			"every level of detail of a mixed cylinder keeps its notch");
+	}
+}
+
+int main()
+{
+	cout << setprecision(4);
+	benchmarkGrid();
+	benchmarkMany();
+	benchmarkSphere();
+	benchmarkCylinder();
+
+	if (failures)
+		cout << failures << " mesh simplifier checks failed" << endl;
+	else
+		cout << "Mesh simplifier checks passed" << endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/* packedvertex_test.cpp
+ Checks the packed vertex format against its error bounds over the whole input range:
+ positions over a grid of the [-1, 1] cube, normals over the sphere including the poles, the
+ axes and signed zeros, and an exact round trip of every RGBA8 colour value.
+ Build and run it on its own, linking the GL loader packedvertex.cpp uses, e.g. from this folder
+   cl /EHsc /I..\include /I..\common packedvertex_test.cpp ..\common\packedvertex.cpp glload.lib
+ Returns 0 when every check passes
+ Andres Alvarez Olmo 2021
+*/
+
+#include "packedvertex.h"
+#include <glm/packing.hpp>
+#include "glm/gtc/packing.hpp"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using namespace std;
+using namespace glm;
+
+static int failures = 0;
+
+/* Only the first few failures of each check are printed */
+static void fail(const char *check, const vec3 &input, GLfloat error)
+{
+	if (++failures <= 10)
+		cout << check << " failed for (" << input.x << ", " << input.y << ", " << input.z << "), error " << error << endl;
+}
+
+static vec3 unpackPosition(const PackedVertex &v)
+{
+	return vec3(unpackSnorm2x16(v.position_xy), unpackSnorm2x16(v.position_zw).x);
+}
+
+static vec3 unpackNormal(const PackedVertex &v)
+{
+	return vec3(unpackSnorm3x10_1x2(v.normal));
+}
+
+static void checkPosition(const vec3 &position)
+{
+	vec3 decoded = unpackPosition(VertexPacking::pack(position, vec3(0.f, 0.f, 1.f)));
+	vec3 error = abs(decoded - position);
+	GLfloat worst = std::max(error.x, std::max(error.y, error.z));
+	if (!(worst <= VertexPacking::POSITION_ERROR))
+		fail("Position", position, worst);
+}
+
+static void checkNormal(const vec3 &normal)
+{
+	vec3 decoded = unpackNormal(VertexPacking::pack(vec3(0.f), normal));
+	GLfloat error = length(normalize(decoded) - normal);
+	if (!(error <= VertexPacking::NORMAL_ERROR))
+		fail("Normal", normal, error);
+}
+
+/* Every step of the grid, so the exact ends, zero and the values half way between two
+   packed steps are all covered */
+static void testPositions()
+{
+	const int STEPS = 200;
+	for (int x = 0; x <= STEPS; x++)
+		for (int y = 0; y <= STEPS; y++)
+			for (int z = 0; z <= STEPS; z++)
+				checkPosition(vec3(x, y, z) * (2.f / STEPS) - 1.f);
+
+	/* Signed zeros and the values just inside the ends */
+	const GLfloat special[] = { 0.f, -0.f, 1.f, -1.f, nextafter(1.f, 0.f), nextafter(-1.f, 0.f),
+		0.5f / 32767.f, -0.5f / 32767.f };
+	for (GLfloat x : special)
+		for (GLfloat y : special)
+			for (GLfloat z : special)
+				checkPosition(vec3(x, y, z));
+}
+
+static void testNormals()
+{
+	/* Latitude and longitude grid, the first and last latitudes are the poles */
+	const int LATS = 360, LONGS = 720;
+	const GLfloat PI = 3.14159265f;
+	for (int i = 0; i <= LATS; i++)
+	{
+		GLfloat lat = PI * i / LATS - PI / 2.f;
+		for (int j = 0; j < LONGS; j++)
+		{
+			GLfloat lon = 2.f * PI * j / LONGS;
+			checkNormal(normalize(vec3(cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat))));
+		}
+	}
+
+	/* The axes, with every combination of signed zeros in the other components, and the diagonals */
+	const GLfloat zeros[] = { 0.f, -0.f };
+	for (GLfloat a : zeros)
+		for (GLfloat b : zeros)
+			for (GLfloat one = -1.f; one <= 1.f; one += 2.f)
+			{
+				checkNormal(vec3(one, a, b));
+				checkNormal(vec3(a, one, b));
+				checkNormal(vec3(a, b, one));
+			}
+	for (int d = 0; d < 8; d++)
+		checkNormal(normalize(vec3(d & 1 ? -1.f : 1.f, d & 2 ? -1.f : 1.f, d & 4 ? -1.f : 1.f)));
+}
+
+/* Each byte has to come back as the same byte, in the order GL_UNSIGNED_BYTE reads them */
+static void testColours()
+{
+	for (GLuint k = 0; k < 256; k++)
+	{
+		GLuint bytes[4] = { k, 255 - k, (k * 7) % 256, (k * 13 + 5) % 256 };
+		vec4 colour = vec4(bytes[0], bytes[1], bytes[2], bytes[3]) / 255.f;
+
+		uint32 packed = VertexPacking::packColour(colour);
+		uint32 expected = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
+		vec4 decoded = unpackUnorm4x8(packed);
+		if (packed != expected || VertexPacking::packColour(decoded) != packed
+			|| any(notEqual(uvec4(round(decoded * 255.f)), uvec4(bytes[0], bytes[1], bytes[2], bytes[3]))))
+			fail("Colour", vec3(colour), (GLfloat)k);
+	}
+}
+
+int main()
+{
+	testPositions();
+	testNormals();
+	testColours();
+
+	if (failures)
+		cout << failures << " packed vertex checks failed" << endl;
+	else
+		cout << "Packed vertex checks passed" << endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/* tube_test.cpp
+ Checks the tube generator by writing its vertices and indices into ordinary memory instead
+ of mapped buffers:
+	vertex and index counts, indices in range and every triangle facing outwards
+	closed paths that aren't periodic are only sampled from 0 to 1, so their ends get the right tangent
+	a closed path off a plane joins its last ring to the first without a twist
+	rings too close together for packed positions get float positions and no triangle collapses
+ Build and run it on its own, linking the GL loader the generator uses, e.g. from this folder
+   cl /EHsc /I..\include /I..\common tube_test.cpp ..\common\tube.cpp ..\common\packedvertex.cpp
+      ..\common\indexbuffer.cpp ..\common\meshcache.cpp ..\common\meshdraw.cpp glload.lib
+ Returns 0 when every check passes
+ Andres Alvarez Olmo 2021
+*/
+
+#include "tube.h"
+#include "packedvertex.h"
+#include "indexbuffer.h"
+#include <glm/packing.hpp>
+#include "glm/gtc/packing.hpp"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using namespace std;
+using namespace glm;
+
+static int failures = 0;
+
+static void check(bool passed, const char *what)
+{
+	if (!passed)
+	{
+		failures++;
+		cout << "  FAILED: " << what << endl;
+	}
+}
+
+/* A sweep written out and unpacked again */
+struct WrittenTube
+{
+	TubeSweep sweep;
+	vector<vec3> positions, normals;
+	vector<GLuint> indices;
+};
+
+static void write(const TubePath &path, GLfloat radius, GLuint segments, GLuint sides, bool closed, WrittenTube &tube)
+{
+	TubeSweep &sweep = tube.sweep;
+	sweep = Tube::plan(path, radius, segments, sides, closed);
+
+	vector<unsigned char> vertices((size_t)sweep.numvertices * sweep.vertexsize);
+	Tube::writeVertices(&vertices[0], sweep, path);
+	tube.positions.resize(sweep.numvertices);
+	tube.normals.resize(sweep.numvertices);
+	for (GLuint v = 0; v < sweep.numvertices; v++)
+	{
+		if (sweep.precise)
+		{
+			const PrecisePackedVertex &vertex = ((const PrecisePackedVertex*)&vertices[0])[v];
+			tube.positions[v] = vertex.position;
+			tube.normals[v] = vec3(unpackSnorm3x10_1x2(vertex.normal));
+		}
+		else
+		{
+			const PackedVertex &vertex = ((const PackedVertex*)&vertices[0])[v];
+			tube.positions[v] = vec3(unpackSnorm2x16(vertex.position_xy), unpackSnorm2x16(vertex.position_zw).x);
+			tube.normals[v] = vec3(unpackSnorm3x10_1x2(vertex.normal));
+		}
+	}
+
+	/* Through the narrowest index type, as makeTube does */
+	GLenum indextype = IndexBuffer::typeFor(sweep.numvertices);
+	vector<unsigned char> indices((size_t)sweep.numindices * IndexBuffer::typeSize(indextype));
+	Tube::writeIndices(&indices[0], sweep, indextype);
+	tube.indices.resize(sweep.numindices);
+	for (GLuint i = 0; i < sweep.numindices; i++)
+	{
+		if (indextype == GL_UNSIGNED_BYTE)
+			tube.indices[i] = ((const GLubyte*)&indices[0])[i];
+		else if (indextype == GL_UNSIGNED_SHORT)
+			tube.indices[i] = ((const GLushort*)&indices[0])[i];
+		else
+			tube.indices[i] = ((const GLuint*)&indices[0])[i];
+	}
+}
+
+/* Counts, index range and winding: each face normal points the same way as its vertex normals */
+static void checkMesh(const WrittenTube &tube, GLuint segments, GLuint sides, bool closed, const char *name)
+{
+	cout << name << ": " << tube.sweep.numvertices << " vertices, " << tube.sweep.numindices / 3 << " triangles"
+		<< (tube.sweep.precise ? ", float positions" : ", packed positions") << ", twist " << tube.sweep.twist << endl;
+
+	check(tube.sweep.numvertices == (closed ? segments : segments + 1) * sides, "the tube has a ring of vertices for each segment");
+	check(tube.sweep.numindices == segments * sides * 6, "the tube has two triangles for each side of each segment");
+
+	size_t outofrange = 0, inwards = 0, degenerate = 0;
+	for (size_t t = 0; t < tube.indices.size(); t += 3)
+	{
+		const GLuint *tri = &tube.indices[t];
+		if (tri[0] >= tube.positions.size() || tri[1] >= tube.positions.size() || tri[2] >= tube.positions.size())
+		{
+			outofrange++;
+			continue;
+		}
+		vec3 face = cross(tube.positions[tri[1]] - tube.positions[tri[0]], tube.positions[tri[2]] - tube.positions[tri[0]]);
+		vec3 normal = tube.normals[tri[0]] + tube.normals[tri[1]] + tube.normals[tri[2]];
+		if (face == vec3(0.f))
+			degenerate++;
+		else if (dot(face, normal) <= 0.f)
+			inwards++;
+	}
+	check(outofrange == 0, "every index is a vertex of the tube");
+	check(inwards == 0, "every triangle faces outwards");
+	check(degenerate == 0, "no triangle collapses to nothing");
+}
+
+/* Largest distance between the same vertex of two rings */
+static GLfloat ringDistance(const WrittenTube &tube, GLuint a, GLuint b)
+{
+	GLuint sides = tube.sweep.sides;
+	GLfloat distance = 0.f;
+	for (GLuint j = 0; j < sides; j++)
+		distance = std::max(distance, length(tube.positions[b * sides + j] - tube.positions[a * sides + j]));
+	return distance;
+}
+
+static void testTorus()
+{
+	const GLuint SEGMENTS = 100, SIDES = 12;
+	TubePath torus = [](GLfloat t) { return vec3(0.7f * cos(6.2831853f * t), 0.f, 0.7f * sin(6.2831853f * t)); };
+	WrittenTube tube;
+	write(torus, 0.2f, SEGMENTS, SIDES, true, tube);
+	checkMesh(tube, SEGMENTS, SIDES, true, "Torus");
+	check(!tube.sweep.precise, "a torus of 100 segments packs its positions");
+	check(abs(tube.sweep.twist) < 1e-3f, "a flat torus has no twist to take out");
+
+	/* Small enough for byte indices */
+	write(torus, 0.2f, 10, 4, true, tube);
+	checkMesh(tube, 10, 4, true, "Small torus");
+}
+
+static void testOpenTube()
+{
+	const GLuint SEGMENTS = 50, SIDES = 8;
+	TubePath wire = [](GLfloat t) { return vec3(-0.8f + 1.6f * t, 0.3f * sin(3.f * t), 0.2f * t * t); };
+	WrittenTube tube;
+	write(wire, 0.05f, SEGMENTS, SIDES, false, tube);
+	checkMesh(tube, SEGMENTS, SIDES, false, "Open wire");
+}
+
+/* A square that starts half way along one side, drawn as straight lines between its corners.
+   It only joins up at t of 0 and 1, beyond them it carries on along the first or last side */
+static void testPolyline()
+{
+	const vec3 CORNERS[] = { vec3(0.5f, 0.f, 0.f), vec3(0.5f, 0.f, 0.5f), vec3(-0.5f, 0.f, 0.5f),
+		vec3(-0.5f, 0.f, -0.5f), vec3(0.5f, 0.f, -0.5f), vec3(0.5f, 0.f, 0.f) };
+	const int NUM_LINES = 5;
+	int outside = 0;
+	TubePath square = [&CORNERS, &outside](GLfloat t)
+	{
+		if (t < 0.f || t > 1.f)
+			outside++;
+		int line = std::min(std::max((int)floor(t * NUM_LINES), 0), NUM_LINES - 1);
+		GLfloat along = t * NUM_LINES - line;
+		return mix(CORNERS[line], CORNERS[line + 1], along);
+	};
+
+	/* No ring on a corner, where a tube of round rings would be pinched */
+	const GLuint SEGMENTS = 42, SIDES = 8;
+	WrittenTube tube;
+	write(square, 0.05f, SEGMENTS, SIDES, true, tube);
+	checkMesh(tube, SEGMENTS, SIDES, true, "Square");
+	check(outside == 0, "a closed path is only sampled from 0 to 1");
+
+	/* The first ring is across the first side, which runs along z */
+	GLfloat across = 0.f;
+	for (GLuint j = 0; j < SIDES; j++)
+		across = std::max(across, abs(tube.positions[j].z - CORNERS[0].z));
+	check(across < 1e-3f, "the first ring of a closed path is at right angles to it");
+}
+
+/* A trefoil knot, whose frame comes back round turned */
+static void testKnot()
+{
+	const GLuint SEGMENTS = 300, SIDES = 8;
+	TubePath knot = [](GLfloat t)
+	{
+		GLfloat a = 6.2831853f * t;
+		return 0.25f * vec3(sin(a) + 2.f * sin(2.f * a), cos(a) - 2.f * cos(2.f * a), -sin(3.f * a));
+	};
+	WrittenTube tube;
+	write(knot, 0.05f, SEGMENTS, SIDES, true, tube);
+	checkMesh(tube, SEGMENTS, SIDES, true, "Trefoil knot");
+	check(abs(tube.sweep.twist) > 0.01f, "the knot's frame comes back turned");
+
+	/* The last ring joins the first no further apart than the other neighbouring rings */
+	GLfloat furthest = 0.f;
+	for (GLuint i = 0; i + 1 < SEGMENTS; i++)
+		furthest = std::max(furthest, ringDistance(tube, i, i + 1));
+	GLfloat join = ringDistance(tube, SEGMENTS - 1, 0);
+	cout << "  join " << join << ", furthest other rings " << furthest << endl;
+	check(join <= furthest * 1.1f, "the ends of the knot join without a twist");
+}
+
+/* Rings about 2e-5 apart on the inside of the torus, under a step of the packed positions */
+static void testFineTorus()
+{
+	const GLuint SEGMENTS = 200000, SIDES = 4;
+	TubePath torus = [](GLfloat t) { return vec3(0.7f * cos(6.2831853f * t), 0.f, 0.7f * sin(6.2831853f * t)); };
+	WrittenTube tube;
+	write(torus, 0.1f, SEGMENTS, SIDES, true, tube);
+	checkMesh(tube, SEGMENTS, SIDES, true, "Fine torus");
+	check(tube.sweep.precise, "rings closer than the packing can tell apart get float positions");
+	check(Tube::plan(torus, 0.1f, 1000000, 16, true).precise, "a million segment torus gets float positions");
+}
+
+int main()
+{
+	testTorus();
+	testOpenTube();
+	testPolyline();
+	testKnot();
+	testFineTorus();
+
+	if (failures)
+		cout << failures << " tube checks failed" << endl;
+	else
+		cout << "Tube checks passed" << endl;
+	return failures ? 1 : 0;
+}